@@ -0,0 +1,83 @@
+// Move latency against a per-move deadline, with and without pondering. Plays
+// Connect4 against a random opponent that takes a fixed time per move, and
+// reports latency and deadline overrun percentiles, simulations per move and
+// how often the pondered tree was reused.
+//
+// Usage: deadlineBench [move_ms] [opponent_ms] [num_games]
+
+#include <arena.h>
+#include <game.h>
+#include <model.h>
+#include <ponderer.h>
+#include <torch/torch.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+void PlayGames(const ConnectXGame& game, Evaluator& model, bool ponder,
+               std::chrono::milliseconds move_time,
+               std::chrono::milliseconds opponent_time, int num_games) {
+  MCTSOptions options;
+  options.lazy_children = true;
+  Ponderer ponderer(game, model, options);
+  RandomPlayer opponent(game, /*seed=*/0);
+
+  for (int game_index = 0; game_index < num_games; ++game_index) {
+    ponderer.Reset();
+    int our_side = game_index % 2 == 0 ? 1 : -1;
+    auto state = game.GetInitBoard();
+    int current_player = 1;
+
+    while (true) {
+      auto canonical_board = game.GetCanonicalBoard(state, current_player);
+      int action;
+      if (current_player == our_side) {
+        action = ponderer.SelectMove(
+            canonical_board, std::chrono::steady_clock::now() + move_time);
+        if (ponder) {
+          ponderer.StartPondering();
+        }
+      } else {
+        std::this_thread::sleep_for(opponent_time);
+        action = opponent.SelectMove(canonical_board);
+      }
+
+      auto state_and_player = game.GetNextState(state, current_player, action);
+      state = state_and_player.board;
+      current_player = state_and_player.player;
+      if (game.GetRewardForPlayer(state, current_player).has_value()) {
+        break;
+      }
+    }
+  }
+  ponderer.StopPondering();
+
+  const auto& stats = ponderer.GetStats();
+  std::cout << (ponder ? "Pondering" : "No pondering") << ":\t" << stats.moves
+            << " moves\t"
+            << ponderer.GetSearchStats().simulations / stats.moves
+            << " simulations per move\t" << stats.hits << " hits\t"
+            << (stats.hits > 0 ? stats.reused_visits / stats.hits : 0)
+            << " visits reused per hit" << std::endl;
+  ponderer.GetLatency().Print(std::cout);
+}
+
+int main(int argc, char** argv) {
+  auto move_time =
+      std::chrono::milliseconds(argc > 1 ? std::atoi(argv[1]) : 50);
+  auto opponent_time =
+      std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 50);
+  int num_games = argc > 3 ? std::atoi(argv[3]) : 10;
+
+  torch::manual_seed(0);
+  torch::set_num_threads(1);
+  auto game = Connect4Game();
+  auto model = Connect2Model(game.GetBoardSize(), game.GetActionSize(),
+                             torch::kCPU);
+
+  for (bool ponder : {false, true}) {
+    PlayGames(game, model, ponder, move_time, opponent_time, num_games);
+  }
+}
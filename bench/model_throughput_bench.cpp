@@ -0,0 +1,63 @@
+// Inference throughput of ResNetModel on Connect4-sized boards for a range of
+// network sizes and batch sizes, to pick a net that fits the self-play budget.
+//
+// Usage: modelThroughputBench [num_threads]
+
+#include <resnet_model.h>
+#include <torch/torch.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Returns positions evaluated per second through predict_batch, so the
+// conversion of the boards and the copies in and out are counted too
+double MeasureThroughput(ResNetModel& model, int batch_size) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> cell_distr(-1, 1);
+  std::vector<int> boards(batch_size * model.board_size);
+  for (auto& cell : boards) {
+    cell = cell_distr(generator);
+  }
+
+  // Warm up, which also folds the batch norms and sizes the buffers
+  for (int i = 0; i < 3; ++i) {
+    model.predict_batch(boards.data(), batch_size);
+  }
+
+  const int kMinPositions = 4096;
+  int iterations = std::max(10, kMinPositions / batch_size);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    model.predict_batch(boards.data(), batch_size);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return iterations * batch_size / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    torch::set_num_threads(std::stoi(argv[1]));
+  }
+
+  torch::Device device(torch::kCPU);
+  if (torch::cuda::is_available()) {
+    device = torch::Device(torch::kCUDA);
+  }
+
+  std::cout << "channels\tblocks\tbatch\tpositions_per_sec" << std::endl;
+  for (auto size : {std::make_pair(32, 3), std::make_pair(64, 5),
+                    std::make_pair(128, 10)}) {
+    ResNetOptions options{/*rows=*/6, /*columns=*/7, /*action_size=*/7,
+                          /*channels=*/size.first, /*num_blocks=*/size.second};
+    ResNetModel model(options, device);
+
+    for (int batch_size : {1, 8, 32, 128, 512}) {
+      std::cout << size.first << "\t" << size.second << "\t" << batch_size
+                << "\t" << MeasureThroughput(model, batch_size) << std::endl;
+    }
+  }
+}
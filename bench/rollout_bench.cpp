@@ -0,0 +1,164 @@
+// Throughput of the random-rollout evaluator: the bitboard line check,
+// vectorized vs. scalar, random playouts per second per core on Connect2 and
+// Connect4 with 1, 2, 4, ... threads, Connect4 playouts per second when
+// predict_batch plays out several leaves together, and search simulations per
+// second with rollouts in place of a network.
+//
+// Usage: rolloutBench [max_threads] [seconds_per_run]
+
+#include <game.h>
+#include <monte_carlo_tree_search.h>
+#include <rollout_evaluator.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+using FindLinesFn = uint32_t (*)(const uint64_t*, int, const BitboardLayout&);
+
+// Returns nanoseconds per board
+double TimeFindLines(FindLinesFn find_lines, const BitboardLayout& layout,
+                     const std::vector<uint64_t>& stones, int iterations,
+                     uint64_t& checksum) {
+  const int kBoardsPerCall = RolloutEvaluator::kRolloutLanes;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    size_t offset = (i * kBoardsPerCall) % (stones.size() - kBoardsPerCall);
+    checksum += find_lines(stones.data() + offset, kBoardsPerCall, layout);
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         (static_cast<double>(iterations) * kBoardsPerCall);
+}
+
+// Plays rollouts from the empty board on every thread for the given time and
+// returns the total per second
+double MeasureRollouts(int rows, int columns, int num_to_win, int num_threads,
+                       double seconds) {
+  std::atomic<uint64_t> total_rollouts(0);
+  auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double>(seconds));
+  auto start = Clock::now();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&, i]() {
+      RolloutOptions options;
+      options.seed = i + 1;
+      RolloutEvaluator evaluator(rows, columns, num_to_win, options);
+      std::vector<int> board(rows * columns, 0);
+      while (Clock::now() < deadline) {
+        evaluator.predict_logits(board);
+      }
+      total_rollouts += evaluator.GetNumRollouts();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  return total_rollouts / elapsed;
+}
+
+// Evaluates batches of Connect4 leaves with few playouts each, which only
+// fill the lanes when the playouts of several leaves share them
+void MeasureBatches(int batch_size, int num_rollouts, double seconds) {
+  RolloutOptions options;
+  options.num_rollouts = num_rollouts;
+  RolloutEvaluator evaluator(FixedConnect4Game::kRows,
+                             FixedConnect4Game::kColumns,
+                             FixedConnect4Game::kNumToWin, options);
+  std::vector<int> boards(batch_size * FixedConnect4Game::kBoardSize, 0);
+  auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double>(seconds));
+  auto start = Clock::now();
+  while (Clock::now() < deadline) {
+    evaluator.predict_batch(boards.data(), batch_size);
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cout << batch_size << "\t" << num_rollouts << "\t"
+            << evaluator.GetNumRollouts() / elapsed << std::endl;
+}
+
+void MeasureSearch(int num_rollouts, int num_searches) {
+  RolloutOptions options;
+  options.num_rollouts = num_rollouts;
+  RolloutEvaluator evaluator(FixedConnect4Game::kRows,
+                             FixedConnect4Game::kColumns,
+                             FixedConnect4Game::kNumToWin, options);
+  auto mcts = BasicMCTS<FixedConnect4Game>(FixedConnect4Game(), evaluator);
+
+  const int kSimulations = 800;
+  auto start = Clock::now();
+  for (int i = 0; i < num_searches; ++i) {
+    auto root = std::unique_ptr<Node>(mcts.Run(
+        FixedConnect4Game::GetInitBoard(), /*to_play=*/1, kSimulations));
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cout << num_rollouts << "\t" << num_searches * kSimulations / elapsed
+            << "\t" << evaluator.GetNumRollouts() / elapsed << std::endl;
+}
+
+int main(int argc, char** argv) {
+  int max_threads = argc > 1 ? std::atoi(argv[1])
+                             : std::thread::hardware_concurrency();
+  double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+
+  BitboardLayout layout(FixedConnect4Game::kRows, FixedConnect4Game::kColumns,
+                        FixedConnect4Game::kNumToWin);
+  std::mt19937_64 generator(42);
+  std::vector<uint64_t> stones(4096);
+  for (auto& board : stones) {
+    // About half the cells, never the spare bit on top of each column
+    board = generator() & generator() & ~(layout.top_row << 1);
+  }
+  const int kIterations = 2000000;
+  uint64_t scalar_checksum = 0, simd_checksum = 0;
+  auto scalar_ns = TimeFindLines(FindLinesScalar, layout, stones, kIterations,
+                                 scalar_checksum);
+  auto simd_ns =
+      TimeFindLines(FindLines, layout, stones, kIterations, simd_checksum);
+  if (scalar_checksum != simd_checksum) {
+    std::cerr << "Scalar and vectorized line checks disagree" << std::endl;
+    return 1;
+  }
+  std::cout << "Line check:\tscalar " << scalar_ns << " ns\tsimd " << simd_ns
+            << " ns\tspeedup " << scalar_ns / simd_ns << std::endl;
+
+  std::cout << "game\tthreads\trollouts_per_second\tper_core" << std::endl;
+  struct Geometry {
+    const char* name;
+    int rows, columns, num_to_win;
+  };
+  for (auto geometry : {Geometry{"connect2", 1, 4, 2},
+                        Geometry{"connect4", 6, 7, 4}}) {
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      auto rate = MeasureRollouts(geometry.rows, geometry.columns,
+                                  geometry.num_to_win, threads, seconds);
+      std::cout << geometry.name << "\t" << threads << "\t" << rate << "\t"
+                << rate / threads << std::endl;
+    }
+  }
+
+  std::cout << "batch_size\trollouts_per_leaf\trollouts_per_second"
+            << std::endl;
+  for (int batch_size : {1, 8, 32}) {
+    MeasureBatches(batch_size, /*num_rollouts=*/1, seconds);
+  }
+
+  std::cout << "rollouts_per_leaf\tsimulations_per_second\trollouts_per_second"
+            << std::endl;
+  for (int num_rollouts : {1, 8, 64}) {
+    MeasureSearch(num_rollouts, /*num_searches=*/num_rollouts > 8 ? 2 : 10);
+  }
+}
@@ -0,0 +1,85 @@
+// Micro-benchmark of PUCT child selection: the vectorized SelectPuctIndex
+// against the scalar reference loop, over a range of branching factors.
+//
+// Build in Release mode for meaningful numbers:
+//   cmake -DCMAKE_BUILD_TYPE=Release .. && make selectChildBench
+
+#include <puct.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using PuctFn = int (*)(const float*, const int*, const float*, int, float,
+                       float);
+
+struct ChildStats {
+  std::vector<float> priors;
+  std::vector<int> visit_counts;
+  std::vector<float> value_sums;
+  float sqrt_parent_visits;
+};
+
+ChildStats MakeChildStats(int num_children, std::mt19937& generator) {
+  std::uniform_real_distribution<float> prior_distr(0, 1);
+  std::uniform_int_distribution<int> visit_distr(0, 200);
+  std::uniform_real_distribution<float> value_distr(-1, 1);
+
+  ChildStats stats;
+  int parent_visits = 1;
+  for (int i = 0; i < num_children; ++i) {
+    stats.priors.push_back(prior_distr(generator) / num_children);
+    stats.visit_counts.push_back(visit_distr(generator));
+    stats.value_sums.push_back(value_distr(generator) *
+                               stats.visit_counts.back());
+    parent_visits += stats.visit_counts.back();
+  }
+  stats.sqrt_parent_visits = std::sqrt(static_cast<float>(parent_visits));
+  return stats;
+}
+
+// Returns nanoseconds per selection
+double TimeSelection(PuctFn select, const std::vector<ChildStats>& nodes,
+                     int iterations, long& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    const ChildStats& node = nodes[i % nodes.size()];
+    checksum += select(node.priors.data(), node.visit_counts.data(),
+                       node.value_sums.data(), node.priors.size(), 1.25,
+                       node.sqrt_parent_visits);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         iterations;
+}
+
+int main() {
+  const int kNumNodes = 1024;
+  const int kIterations = 2000000;
+  std::mt19937 generator(42);
+
+  std::cout << "children\tscalar_ns\tsimd_ns\tspeedup" << std::endl;
+  for (int num_children : {4, 7, 16, 42, 81, 361}) {
+    std::vector<ChildStats> nodes;
+    for (int i = 0; i < kNumNodes; ++i) {
+      nodes.push_back(MakeChildStats(num_children, generator));
+    }
+
+    long scalar_checksum = 0, simd_checksum = 0;
+    auto scalar_ns =
+        TimeSelection(SelectPuctIndexScalar, nodes, kIterations, scalar_checksum);
+    auto simd_ns =
+        TimeSelection(SelectPuctIndex, nodes, kIterations, simd_checksum);
+
+    if (scalar_checksum != simd_checksum) {
+      std::cerr << "Scalar and vectorized selection disagree for "
+                << num_children << " children" << std::endl;
+      return 1;
+    }
+
+    std::cout << num_children << "\t" << scalar_ns << "\t" << simd_ns << "\t"
+              << scalar_ns / simd_ns << std::endl;
+  }
+}
@@ -0,0 +1,178 @@
+// Strength-per-compute regression benchmark. Trains a fresh model for a fixed
+// wall-clock or CPU-second budget, then plays it against fixed opponents and
+// reports its score next to the compute it was given, as JSON.
+//
+// Usage: strengthBench [--game connect2|connect4] [--wall-seconds N]
+//                      [--cpu-seconds N] [--games N] [--simulations N]
+//                      [--threads N] [--seed N] [--reference checkpoint]
+//                      [--save checkpoint] [--output summary.json]
+//                      [--prioritized-replay 0|1]
+//
+// Everything runs on the CPU with fixed seeds. Pass --save once to pin a
+// checkpoint, then --reference on later runs to play against it.
+
+#include <arena.h>
+#include <game.h>
+#include <model.h>
+#include <thread_budget.h>
+#include <torch/torch.h>
+#include <trainer.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+struct BenchmarkOptions {
+  std::string game = "connect4";
+  double wall_seconds = 60;
+  double cpu_seconds = 0;
+  int games = 40;
+  int simulations = 50;
+  int threads = 1;
+  uint32_t seed = 1;
+  std::string reference;
+  std::string save;
+  std::string output;
+  bool prioritized_replay = false;
+};
+
+BenchmarkOptions ParseArgs(int argc, char** argv) {
+  std::map<std::string, std::string> args;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    args[argv[i]] = argv[i + 1];
+  }
+
+  BenchmarkOptions options;
+  auto get = [&args](const std::string& name, const std::string& fallback) {
+    auto it = args.find(name);
+    return it == args.end() ? fallback : it->second;
+  };
+  options.game = get("--game", options.game);
+  options.wall_seconds = std::stod(get("--wall-seconds", "60"));
+  options.cpu_seconds = std::stod(get("--cpu-seconds", "0"));
+  options.games = std::stoi(get("--games", "40"));
+  options.simulations = std::stoi(get("--simulations", "50"));
+  options.threads = std::stoi(get("--threads", "1"));
+  options.seed = std::stoul(get("--seed", "1"));
+  options.reference = get("--reference", "");
+  options.save = get("--save", "");
+  options.output = get("--output", "");
+  options.prioritized_replay = get("--prioritized-replay", "0") == "1";
+  return options;
+}
+
+void LoadCheckpoint(Connect2Model& model, const std::string& path) {
+  torch::serialize::InputArchive archive;
+  archive.load_from(path);
+  model.load(archive);
+}
+
+void SaveCheckpoint(Connect2Model& model, const std::string& path) {
+  torch::serialize::OutputArchive archive;
+  model.save(archive);
+  archive.save_to(path);
+}
+
+template <typename TrainingGame>
+std::string RunBenchmark(const TrainingGame& training_game,
+                         const ConnectXGame& game,
+                         const BenchmarkOptions& options) {
+  int board_size = training_game.GetBoardSize();
+  int action_size = training_game.GetActionSize();
+  auto model = Connect2Model(board_size, action_size, torch::kCPU);
+
+  // 1. Train within the budget
+  TrainerOptions trainer_options;
+  trainer_options.batch_size = 64;
+  trainer_options.num_episodes = 20;
+  trainer_options.num_epochs = 1;
+  trainer_options.num_simulations = options.simulations;
+  trainer_options.training_iterations = 1000000;
+  trainer_options.max_wall_seconds = options.wall_seconds;
+  trainer_options.max_cpu_seconds = options.cpu_seconds;
+  trainer_options.mcts_options.use_solver = true;
+  trainer_options.mcts_options.lazy_children = true;
+  trainer_options.replay.enabled = options.prioritized_replay;
+  auto trainer = BasicTrainer<TrainingGame>(training_game, model,
+                                            trainer_options);
+
+  auto start_time = std::chrono::steady_clock::now();
+  auto start_cpu_seconds = GetProcessUsage().cpu_seconds;
+  auto iterations = trainer.Learn();
+  double train_cpu_seconds = GetProcessUsage().cpu_seconds - start_cpu_seconds;
+  std::chrono::duration<double> train_wall_seconds =
+      std::chrono::steady_clock::now() - start_time;
+
+  auto& trained_model = trainer.GetModel();
+  if (!options.save.empty()) {
+    SaveCheckpoint(trained_model, options.save);
+  }
+
+  // 2. Play the fixed opponents
+  MCTSOptions mcts_options;
+  mcts_options.lazy_children = true;
+  MCTSPlayer player(game, trained_model, options.simulations, mcts_options);
+
+  RandomPlayer random_player(game, options.seed);
+  MinimaxPlayer minimax_player(game, /*depth=*/2, options.seed);
+  std::vector<std::pair<std::string, Player*>> opponents = {
+      {"random", &random_player}, {"minimax_depth_2", &minimax_player}};
+
+  auto reference_model = Connect2Model(board_size, action_size, torch::kCPU);
+  std::unique_ptr<MCTSPlayer> reference_player;
+  if (!options.reference.empty()) {
+    LoadCheckpoint(reference_model, options.reference);
+    reference_player = std::make_unique<MCTSPlayer>(
+        game, reference_model, options.simulations, mcts_options);
+    opponents.emplace_back("reference", reference_player.get());
+  }
+
+  // 3. Report the score against the compute spent
+  std::stringstream summary;
+  summary << "{\"game\":\"" << options.game << "\",\"seed\":" << options.seed
+          << ",\"simulations\":" << options.simulations
+          << ",\"threads\":" << options.threads
+          << ",\"prioritized_replay\":"
+          << (options.prioritized_replay ? "true" : "false")
+          << ",\"train_iterations\":" << iterations
+          << ",\"train_wall_seconds\":" << train_wall_seconds.count()
+          << ",\"train_cpu_seconds\":" << train_cpu_seconds
+          << ",\"opponents\":[";
+  for (size_t i = 0; i < opponents.size(); ++i) {
+    auto result = PlayMatch(game, player, *opponents[i].second, options.games);
+    summary << (i == 0 ? "" : ",") << "{\"name\":\"" << opponents[i].first
+            << "\",\"games\":" << result.GetNumGames()
+            << ",\"wins\":" << result.wins << ",\"draws\":" << result.draws
+            << ",\"losses\":" << result.losses
+            << ",\"score\":" << result.GetScore() << "}";
+  }
+  summary << "]}";
+  return summary.str();
+}
+
+int main(int argc, char** argv) {
+  auto options = ParseArgs(argc, argv);
+
+  torch::manual_seed(options.seed);
+  std::srand(options.seed);
+  torch::set_num_threads(options.threads);
+
+  std::string summary;
+  if (options.game == "connect2") {
+    summary = RunBenchmark(FixedConnect2Game(), Connect2Game(), options);
+  } else if (options.game == "connect4") {
+    summary = RunBenchmark(FixedConnect4Game(), Connect4Game(), options);
+  } else {
+    std::cerr << "Unknown game: " << options.game << std::endl;
+    return 1;
+  }
+
+  std::cout << summary << std::endl;
+  if (!options.output.empty()) {
+    std::ofstream(options.output) << summary << std::endl;
+  }
+}
@@ -0,0 +1,95 @@
+// Scaling of data-parallel and hogwild CPU training with the number of
+// threads. Trains identical models on the same random Connect4-sized examples
+// and reports throughput, speedup, parallel efficiency and how far the loss
+// lands from single-threaded training.
+//
+// Usage: trainingScalingBench [max_threads] [num_examples] [batch_size]
+//
+// Train logs to stdout as usual; the results are written to stderr.
+
+#include <game.h>
+#include <model.h>
+#include <torch/torch.h>
+#include <trainer.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+std::vector<Example> MakeExamples(int num_examples) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> cell_distr(-1, 1);
+  std::uniform_real_distribution<float> prob_distr(0, 1);
+
+  std::vector<Example> examples(num_examples);
+  for (auto& example : examples) {
+    example.canonical_board.resize(FixedConnect4Game::kBoardSize);
+    for (auto& cell : example.canonical_board) {
+      cell = cell_distr(generator);
+    }
+    example.current_player = 1;
+    example.action_probs.resize(FixedConnect4Game::kActionSize);
+    float sum = 0;
+    for (auto& prob : example.action_probs) {
+      prob = prob_distr(generator);
+      sum += prob;
+    }
+    for (auto& prob : example.action_probs) {
+      prob /= sum;
+    }
+    example.reward = cell_distr(generator);
+  }
+  return examples;
+}
+
+int main(int argc, char** argv) {
+  int max_threads = argc > 1 ? std::atoi(argv[1])
+                             : std::thread::hardware_concurrency();
+  int num_examples = argc > 2 ? std::atoi(argv[2]) : 16384;
+  uint32_t batch_size = argc > 3 ? std::atoi(argv[3]) : 256;
+
+  auto examples = MakeExamples(num_examples);
+  torch::set_num_threads(1);
+
+  for (bool hogwild : {false, true}) {
+    double base_seconds = 0;
+    double base_loss = 0;
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+      torch::manual_seed(0);
+      auto model = Connect2Model(FixedConnect4Game::kBoardSize,
+                                 FixedConnect4Game::kActionSize, torch::kCPU);
+      TrainerOptions options;
+      options.batch_size = batch_size;
+      options.num_episodes = 0;
+      options.num_epochs = 1;
+      options.num_simulations = 0;
+      options.training_iterations = 0;
+      options.data_parallel_threads = num_threads;
+      options.hogwild = hogwild;
+      auto trainer =
+          BasicTrainer<FixedConnect4Game>(FixedConnect4Game(), model, options);
+
+      auto start = std::chrono::steady_clock::now();
+      auto losses = trainer.Train(examples);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+      double loss = losses.policy + losses.value;
+      if (num_threads == 1) {
+        base_seconds = elapsed.count();
+        base_loss = loss;
+      }
+      double speedup = base_seconds / elapsed.count();
+      std::cerr << (hogwild ? "hogwild" : "data-parallel")
+                << "\tthreads " << num_threads << "\t"
+                << num_examples / elapsed.count() << " examples/s\tspeedup "
+                << speedup << "\tefficiency " << 100 * speedup / num_threads
+                << "%\tloss " << loss << "\tloss difference "
+                << std::abs(loss - base_loss) << std::endl;
+    }
+  }
+}
@@ -1,12 +1,29 @@
 #include <torch/torch.h>
 
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 #include "game.h"
+#include "game_record.h"
 #include "model.h"
+#include "thread_budget.h"
+#include "tracer.h"
 #include "trainer.h"
 
-int main() {
+// Usage: AlphaZeroCpp [--record-games game_records]
+int main(int argc, char** argv) {
+  // Self-play games are only recorded when asked for, as the file grows with
+  // every run
+  std::unique_ptr<GameRecordWriter> game_records;
+  if (argc == 3 && std::strcmp(argv[1], "--record-games") == 0) {
+    game_records = std::make_unique<GameRecordWriter>(argv[2]);
+  } else if (argc != 1) {
+    std::cerr << "Usage: " << argv[0] << " [--record-games game_records]"
+              << std::endl;
+    return 1;
+  }
+
   auto game = Connect2Game();
   auto board_size = game.GetBoardSize();
   auto action_size = game.GetActionSize();
@@ -19,6 +36,11 @@ int main() {
     std::cout << "Setting device: torch::kCPU" << std::endl;
   }
 
+  // Nothing here uses libtorch's inter-op parallelism; the self-play workers
+  // and intra-op threads are sized by the thread budget instead.
+  torch::set_num_interop_threads(1);
+  auto thread_budget = ThreadBudget(ThreadBudgetOptions());
+
   auto model = Connect2Model(board_size, action_size, device);
   auto options = TrainerOptions();
   options.batch_size = 64;
@@ -26,6 +48,15 @@ int main() {
   options.num_epochs = 1;
   options.num_simulations = 100;
   options.training_iterations = 500;
+  options.mcts_options.use_solver = true;
+  options.mcts_options.lazy_children = true;
+  options.merge_duplicates = true;
+  options.thread_budget = &thread_budget;
+  options.game_records = game_records.get();
+#ifdef ALPHAZERO_TRACING
+  Tracer::Start();
+  options.trace_path = "trace.json";
+#endif
   auto trainer = Trainer(game, model, options);
 
   trainer.Learn();
@@ -0,0 +1,111 @@
+#include "arena.h"
+
+#include <memory>
+
+namespace {
+
+std::vector<int> GetLegalActions(const ConnectXGame& game,
+                                 const std::vector<int>& board) {
+  std::vector<int> actions;
+  auto valid_moves = game.GetValidMoves(board);
+  for (size_t action = 0; action < valid_moves.size(); ++action) {
+    if (valid_moves[action] != 0) {
+      actions.push_back(action);
+    }
+  }
+  return actions;
+}
+
+}  // namespace
+
+int RandomPlayer::SelectMove(const std::vector<int>& canonical_board) {
+  auto actions = GetLegalActions(game_, canonical_board);
+  std::uniform_int_distribution<size_t> distr(0, actions.size() - 1);
+  return actions[distr(generator_)];
+}
+
+int MinimaxPlayer::SelectMove(const std::vector<int>& canonical_board) {
+  int best_value = -2;
+  std::vector<int> best_actions;
+  for (auto action : GetLegalActions(game_, canonical_board)) {
+    auto next = canonical_board;
+    game_.PlayMove(next, /*player=*/1, action);
+    game_.MakeCanonical(next, /*player=*/-1);
+    int value = -Negamax_(next, depth_ - 1);
+
+    if (value > best_value) {
+      best_value = value;
+      best_actions.clear();
+    }
+    if (value == best_value) {
+      best_actions.push_back(action);
+    }
+  }
+
+  std::uniform_int_distribution<size_t> distr(0, best_actions.size() - 1);
+  return best_actions[distr(generator_)];
+}
+
+int MinimaxPlayer::Negamax_(const std::vector<int>& board, int depth) const {
+  // The reward for the player to move on a canonical board
+  auto reward = game_.GetRewardForPlayer(board, /*player=*/1);
+  if (reward.has_value()) {
+    return reward.value();
+  }
+  if (depth <= 0) {
+    return 0;
+  }
+
+  int best_value = -1;
+  for (auto action : GetLegalActions(game_, board)) {
+    auto next = board;
+    game_.PlayMove(next, /*player=*/1, action);
+    game_.MakeCanonical(next, /*player=*/-1);
+    best_value = std::max(best_value, -Negamax_(next, depth - 1));
+    if (best_value == 1) {
+      break;
+    }
+  }
+  return best_value;
+}
+
+int MCTSPlayer::SelectMove(const std::vector<int>& canonical_board) {
+  auto root = std::unique_ptr<Node>(
+      mcts_.Run(canonical_board, /*to_play=*/1, num_simulations_));
+  return root->SelectAction(/*temperature=*/0);
+}
+
+MatchResult PlayMatch(const ConnectXGame& game, Player& player,
+                      Player& opponent, int num_games) {
+  MatchResult result;
+  for (int game_index = 0; game_index < num_games; ++game_index) {
+    // The game's first mover is always game player 1
+    int our_side = game_index % 2 == 0 ? 1 : -1;
+    auto state = game.GetInitBoard();
+    int current_player = 1;
+
+    while (true) {
+      Player& mover = current_player == our_side ? player : opponent;
+      auto action =
+          mover.SelectMove(game.GetCanonicalBoard(state, current_player));
+      auto state_and_player = game.GetNextState(state, current_player, action);
+      state = state_and_player.board;
+      current_player = state_and_player.player;
+
+      auto reward = game.GetRewardForPlayer(state, current_player);
+      if (reward.has_value()) {
+        int our_reward = current_player == our_side ? reward.value()
+                                                    : -reward.value();
+        if (our_reward > 0) {
+          ++result.wins;
+        } else if (our_reward < 0) {
+          ++result.losses;
+        } else {
+          ++result.draws;
+        }
+        break;
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,80 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "evaluator.h"
+#include "game.h"
+#include "monte_carlo_tree_search.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Anything that can pick a move, to be pitted against other players
+class Player {
+ public:
+  virtual ~Player() = default;
+  // Picks a legal move for the player to move on a canonical board
+  virtual int SelectMove(const std::vector<int>& canonical_board) = 0;
+};
+
+class RandomPlayer : public Player {
+ public:
+  RandomPlayer(const ConnectXGame& game, uint32_t seed)
+      : game_(game), generator_(seed) {}
+
+  int SelectMove(const std::vector<int>& canonical_board) override;
+
+ private:
+  const ConnectXGame& game_;
+  std::mt19937 generator_;
+};
+
+// Depth-limited negamax that only knows about wins and losses, breaking ties
+// between equally good moves at random.
+class MinimaxPlayer : public Player {
+ public:
+  MinimaxPlayer(const ConnectXGame& game, int depth, uint32_t seed)
+      : game_(game), depth_(depth), generator_(seed) {}
+
+  int SelectMove(const std::vector<int>& canonical_board) override;
+
+ private:
+  const ConnectXGame& game_;
+  int depth_;
+  std::mt19937 generator_;
+
+  int Negamax_(const std::vector<int>& board, int depth) const;
+};
+
+// Plays the most visited move of a fresh search from every position
+class MCTSPlayer : public Player {
+ public:
+  MCTSPlayer(const ConnectXGame& game, Evaluator& model, int num_simulations,
+             MCTSOptions options = MCTSOptions())
+      : mcts_(game, model, options), num_simulations_(num_simulations) {}
+
+  int SelectMove(const std::vector<int>& canonical_board) override;
+
+ private:
+  MCTS mcts_;
+  int num_simulations_;
+};
+
+// Game results counted from the first player's side of PlayMatch
+struct MatchResult {
+  int wins = 0;
+  int draws = 0;
+  int losses = 0;
+
+  int GetNumGames() const { return wins + draws + losses; }
+  // Wins plus half the draws, as a fraction of the games
+  double GetScore() const {
+    return GetNumGames() == 0 ? 0 : (wins + 0.5 * draws) / GetNumGames();
+  }
+};
+
+// Plays num_games between the two players, taking turns to move first
+MatchResult PlayMatch(const ConnectXGame& game, Player& player,
+                      Player& opponent, int num_games);
+
+#endif /* ARENA_H */
@@ -0,0 +1,135 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// During prediction, we simply want the raw numerical values for
+// actionProbs and our value.
+struct ActionProbsAndValue {
+  std::vector<float> action_probs;
+  float value;
+};
+
+// The policy before its softmax, so that the search can normalize over the
+// legal moves alone.
+struct ActionLogitsAndValue {
+  std::vector<float> action_logits;
+  float value;
+};
+
+// The output of predict_batch: row i of action_logits, action_size floats
+// long, and values[i] belong to board i. Points into buffers the evaluator
+// keeps for the calling thread, which its next predict_batch call on that
+// thread reuses.
+struct BatchPrediction {
+  const float* action_logits;
+  const float* values;
+  int batch_size;
+  int action_size;
+
+  const float* GetActionLogits(int i) const {
+    return action_logits + static_cast<size_t>(i) * action_size;
+  }
+};
+
+// Scratch memory of type Buffers that an evaluator keeps for each thread
+// calling it. Keeping it per evaluator as well as per thread means evaluators
+// sharing a thread, such as two players in an arena, don't overwrite each
+// other's BatchPrediction or keep resizing each other's buffers, and the
+// buffers go away with their evaluator. Each thread remembers the last
+// buffers it got, so repeated calls don't take the lock.
+template <typename Buffers>
+class ThreadBuffers {
+ public:
+  ThreadBuffers() : id_(next_id_++) {}
+  // A copied evaluator gets buffers of its own
+  ThreadBuffers(const ThreadBuffers&) : ThreadBuffers() {}
+  ThreadBuffers& operator=(const ThreadBuffers&) { return *this; }
+
+  Buffers& Get() const {
+    // Ids are never reused, so a destroyed owner's id can't match again
+    thread_local uint64_t cached_id = 0;
+    thread_local Buffers* cached_buffers = nullptr;
+    if (cached_id != id_) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& buffers = buffers_[std::this_thread::get_id()];
+      if (buffers == nullptr) {
+        buffers = std::make_unique<Buffers>();
+      }
+      cached_id = id_;
+      cached_buffers = buffers.get();
+    }
+    return *cached_buffers;
+  }
+
+ private:
+  static inline std::atomic<uint64_t> next_id_{1};
+  uint64_t id_;
+  mutable std::mutex mutex_;
+  mutable std::unordered_map<std::thread::id, std::unique_ptr<Buffers>>
+      buffers_;
+};
+
+// Policy and value for a board, as needed by the search. Nothing here depends
+// on libtorch, so searches, games and tools can be built without it; Model
+// adds the tensor interface used in training.
+struct Evaluator {
+  Evaluator(int board_size, int action_size)
+      : board_size(board_size), action_size(action_size) {}
+  // Evaluators are often owned through a pointer to this base
+  virtual ~Evaluator() = default;
+
+  int board_size;
+  int action_size;
+
+  virtual ActionProbsAndValue predict(std::vector<int>& board) = 0;
+  // Evaluators that compute logits should override this to skip the softmax.
+  // The log of the probabilities serves for any other evaluator.
+  virtual ActionLogitsAndValue predict_logits(std::vector<int>& board) {
+    auto result = predict(board);
+    for (auto& prob : result.action_probs) {
+      prob = std::log(prob);
+    }
+    return {std::move(result.action_probs), result.value};
+  }
+  // Evaluates batch_size boards laid out one after another. Evaluators that can
+  // run a whole batch at once should override this; the default evaluates the
+  // boards one by one with predict_logits.
+  virtual BatchPrediction predict_batch(const int* boards, int batch_size) {
+    auto& buffers = batch_buffers_.Get();
+    buffers.action_logits.resize(static_cast<size_t>(batch_size) *
+                                 action_size);
+    buffers.values.resize(batch_size);
+
+    for (int i = 0; i < batch_size; ++i) {
+      buffers.board.assign(boards + i * board_size,
+                           boards + (i + 1) * board_size);
+      auto result = predict_logits(buffers.board);
+      std::copy(result.action_logits.begin(), result.action_logits.end(),
+                buffers.action_logits.begin() + i * action_size);
+      buffers.values[i] = result.value;
+    }
+
+    return {buffers.action_logits.data(), buffers.values.data(), batch_size,
+            action_size};
+  }
+
+ private:
+  struct BatchBuffers {
+    std::vector<int> board;
+    std::vector<float> action_logits;
+    std::vector<float> values;
+  };
+  ThreadBuffers<BatchBuffers> batch_buffers_;
+};
+
+#endif /* EVALUATOR_H */
@@ -0,0 +1,78 @@
+#include "example.h"
+
+#include "game.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Folds other into merged as a weighted running average
+void MergeInto(Example& merged, const Example& other) {
+  float total_weight = merged.weight + other.weight;
+  float other_share = other.weight / total_weight;
+  for (size_t i = 0; i < merged.action_probs.size(); ++i) {
+    merged.action_probs[i] +=
+        other_share * (other.action_probs[i] - merged.action_probs[i]);
+  }
+  merged.reward += other_share * (other.reward - merged.reward);
+  merged.weight = total_weight;
+  merged.weight_version =
+      std::max(merged.weight_version, other.weight_version);
+}
+
+}  // namespace
+
+std::vector<Example> MergeDuplicateExamples(
+    const std::vector<Example>& examples, int num_threads) {
+  num_threads = std::max(1, num_threads);
+  auto run_on_threads = [num_threads](const std::function<void(int)>& work) {
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i) {
+      threads.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+
+  std::vector<uint64_t> hashes(examples.size());
+  run_on_threads([&](int thread_index) {
+    for (size_t i = thread_index; i < examples.size(); i += num_threads) {
+      hashes[i] = HashBoard(examples[i].canonical_board);
+    }
+  });
+
+  // Each thread merges the boards whose hash falls in its partition, in the
+  // order they were played, so the result doesn't depend on timing
+  std::vector<std::vector<Example>> partitions(num_threads);
+  run_on_threads([&](int partition) {
+    auto& merged = partitions[partition];
+    std::unordered_map<uint64_t, size_t> index_of_hash;
+    for (size_t i = 0; i < examples.size(); ++i) {
+      if (hashes[i] % num_threads != static_cast<uint64_t>(partition)) {
+        continue;
+      }
+      auto it = index_of_hash.find(hashes[i]);
+      if (it != index_of_hash.end() &&
+          merged[it->second].canonical_board == examples[i].canonical_board) {
+        MergeInto(merged[it->second], examples[i]);
+      } else {
+        // On a hash collision the later board is kept apart, unmerged
+        index_of_hash.emplace(hashes[i], merged.size());
+        merged.push_back(examples[i]);
+      }
+    }
+  });
+
+  std::vector<Example> result;
+  for (auto& partition : partitions) {
+    result.insert(result.end(), std::make_move_iterator(partition.begin()),
+                  std::make_move_iterator(partition.end()));
+  }
+  return result;
+}
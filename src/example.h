@@ -0,0 +1,30 @@
+#ifndef EXAMPLE_H
+#define EXAMPLE_H
+
+#include <cstdint>
+#include <vector>
+
+// One training position: the board seen by the player to move, the search's
+// visit distribution as the policy target and the game's result for that
+// player as the value target.
+struct Example {
+  std::vector<int> canonical_board;
+  int current_player;
+  std::vector<float> action_probs;
+  // 1 win, 0 draw, -1 loss, or their average over merged duplicates
+  float reward;
+  // The WeightPublisher version of the weights that played the move, zero if
+  // unknown
+  uint64_t weight_version = 0;
+  // How many positions this example stands for in the loss
+  float weight = 1;
+};
+
+// Merges the examples of the same canonical board into one, averaging their
+// targets and adding up their weights, so the loss is unchanged while each
+// position is evaluated once. The boards are partitioned by hash between
+// num_threads threads. The merged example keeps the newest weight_version.
+std::vector<Example> MergeDuplicateExamples(
+    const std::vector<Example>& examples, int num_threads = 1);
+
+#endif /* EXAMPLE_H */
@@ -0,0 +1,138 @@
+#ifndef FIXED_GAME_H
+#define FIXED_GAME_H
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+// ConnectX with the board dimensions fixed at compile time. Pieces dropped in a
+// column fall to the lowest empty row (row 0 is the top), so an action is a
+// column. Boards are std::array and the game has no state, so every method is
+// static and search and training code templated on the game can inline and
+// unroll every call.
+//
+// Use ConnectXGameAdapter to get the same game behind the ConnectXGame
+// interface.
+template <int Rows, int Columns, int NumToWin>
+class FixedConnectXGame {
+  static_assert(NumToWin <= Rows || NumToWin <= Columns,
+                "The board is too small to ever win");
+
+ public:
+  static constexpr int kRows = Rows;
+  static constexpr int kColumns = Columns;
+  static constexpr int kNumToWin = NumToWin;
+  static constexpr int kBoardSize = Rows * Columns;
+  static constexpr int kActionSize = Columns;
+
+  using Board = std::array<int, kBoardSize>;
+  using ValidMoves = std::array<int, kActionSize>;
+
+  struct StateAndPlayer {
+    Board board;
+    int player;
+  };
+
+  static constexpr int GetBoardSize() { return kBoardSize; }
+  static constexpr int GetActionSize() { return kActionSize; }
+
+  static Board GetInitBoard() { return Board{}; }
+
+  static StateAndPlayer GetNextState(const Board& board, int player,
+                                     int action) {
+    Board new_board(board);
+    PlayMove(new_board, player, action);
+    return {new_board, -player};
+  }
+
+  static void PlayMove(Board& board, int player, int action) {
+    for (int row = Rows - 1; row >= 0; --row) {
+      int& cell = board[row * Columns + action];
+      if (cell == 0) {
+        cell = player;
+        return;
+      }
+    }
+  }
+
+  static void MakeCanonical(Board& board, int player) {
+    for (auto& cell : board) {
+      cell *= player;
+    }
+  }
+
+  static ValidMoves GetValidMoves(const Board& board) {
+    // A column is playable as long as its top cell is empty
+    ValidMoves valid_moves;
+    for (int column = 0; column < Columns; ++column) {
+      valid_moves[column] = board[column] == 0;
+    }
+    return valid_moves;
+  }
+
+  static bool HasLegalMoves(const Board& board) {
+    // Scan the top row as a range of the board itself rather than by index:
+    // GCC folds identical instantiations that share Columns (e.g. 4x5 and
+    // 5x5) and then warns about the smaller board under -Warray-bounds.
+    const auto top_row_end = board.begin() + Columns;
+    return std::find(board.begin(), top_row_end, 0) != top_row_end;
+  }
+
+  static bool IsWin(const Board& board, int player) {
+    return HasLine(board, player, 0, 1) || HasLine(board, player, 1, 0) ||
+           HasLine(board, player, 1, 1) || HasLine(board, player, 1, -1);
+  }
+
+  static std::optional<int> GetRewardForPlayer(const Board& board,
+                                               int player) {
+    if (IsWin(board, player)) {
+      return 1;
+    }
+
+    if (IsWin(board, -player)) {
+      return -1;
+    }
+
+    if (!HasLegalMoves(board)) {
+      return 0;
+    }
+
+    return std::nullopt;
+  }
+
+  static Board GetCanonicalBoard(const Board& board, int player) {
+    Board canonical_board(board);
+    MakeCanonical(canonical_board, player);
+    return canonical_board;
+  }
+
+ private:
+  // Whether the player has NumToWin pieces in a row along (d_row, d_column)
+  static bool HasLine(const Board& board, int player, int d_row,
+                      int d_column) {
+    constexpr int kSpan = NumToWin - 1;
+    const int first_column = d_column < 0 ? kSpan : 0;
+    const int last_column = d_column > 0 ? Columns - 1 - kSpan : Columns - 1;
+    const int last_row = d_row > 0 ? Rows - 1 - kSpan : Rows - 1;
+
+    for (int row = 0; row <= last_row; ++row) {
+      for (int column = first_column; column <= last_column; ++column) {
+        int count = 0;
+        while (count < NumToWin &&
+               board[(row + count * d_row) * Columns + column +
+                     count * d_column] == player) {
+          ++count;
+        }
+        if (count == NumToWin) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+};
+
+using FixedConnect2Game = FixedConnectXGame<1, 4, 2>;
+using FixedConnect4Game = FixedConnectXGame<6, 7, 4>;
+
+#endif /* FIXED_GAME_H */
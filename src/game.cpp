@@ -1,84 +1,54 @@
 #include "game.h"
 
-#include <algorithm>
-#include <functional>
+#include <stdexcept>
+#include <string>
 
-std::vector<int> Connect2Game::GetInitBoard() const {
-  return std::vector<int>(columns, 0);
-}
-
-StateAndPlayer Connect2Game::GetNextState(const std::vector<int>& board,
-                                          int player, int action) const {
-  std::vector<int> new_board(board);
-
-  new_board[action] = player;
-
-  return {new_board, -player};
-}
-
-std::vector<int> Connect2Game::GetValidMoves(
-    const std::vector<int>& board) const {
-  std::vector<int> valid_moves(columns, 0);
+namespace {
 
-  for (size_t i = 0; i < columns; ++i) {
-    if (board[i] == 0) {
-      valid_moves[i] = 1;
-    }
+template <int Rows, int Columns, int NumToWin>
+bool MakeIfMatches(int rows, int columns, int num_to_win,
+                   std::unique_ptr<ConnectXGame>& game) {
+  if (rows != Rows || columns != Columns || num_to_win != NumToWin) {
+    return false;
   }
-
-  return valid_moves;
-}
-
-bool Connect2Game::HasLegalMoves(const std::vector<int>& board) const {
-  for (size_t i = 0; i < columns; ++i) {
-    if (board[i] == 0) {
-      return true;
-    }
-  }
-
-  return false;
+  game = std::make_unique<
+      ConnectXGameAdapter<FixedConnectXGame<Rows, Columns, NumToWin>>>();
+  return true;
 }
 
-bool Connect2Game::IsWin(const std::vector<int>& board, int player) const {
-  int count = 0;
+}  // namespace
 
-  for (size_t i = 0; i < columns; ++i) {
-    if (board[i] == player) {
-      ++count;
-    } else {
-      count = 0;
-    }
-
-    if (count == num_to_win) {
-      return true;
-    }
-  }
-
-  return false;
-}
-
-std::optional<int> Connect2Game::GetRewardForPlayer(
-    const std::vector<int>& board, int player) const {
-  if (IsWin(board, player)) {
-    return 1;
+uint64_t HashBoard(const int* cells, size_t num_cells) {
+  // FNV-1a over the cells followed by a splitmix64 finalizer
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < num_cells; ++i) {
+    hash ^= static_cast<uint64_t>(cells[i] + 2);
+    hash *= 1099511628211ULL;
   }
 
-  if (IsWin(board, -player)) {
-    return -1;
-  }
-
-  if (!HasLegalMoves(board)) {
-    return 0;
-  }
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
 
-  return std::nullopt;
+  return hash == 0 ? 1 : hash;
 }
 
-std::vector<int> Connect2Game::GetCanonicalBoard(
-    const std::vector<int>& old_board, int player) const {
-  std::vector<int> board(old_board);
-  std::transform(board.begin(), board.end(), board.begin(),
-                 std::bind(std::multiplies<int>(), std::placeholders::_1, -1));
-
-  return board;
+std::unique_ptr<ConnectXGame> MakeConnectXGame(int rows, int columns,
+                                               int num_to_win) {
+  std::unique_ptr<ConnectXGame> game;
+  if (MakeIfMatches<1, 4, 2>(rows, columns, num_to_win, game) ||
+      MakeIfMatches<4, 4, 3>(rows, columns, num_to_win, game) ||
+      MakeIfMatches<4, 5, 4>(rows, columns, num_to_win, game) ||
+      MakeIfMatches<5, 5, 4>(rows, columns, num_to_win, game) ||
+      MakeIfMatches<5, 6, 4>(rows, columns, num_to_win, game) ||
+      MakeIfMatches<6, 7, 4>(rows, columns, num_to_win, game) ||
+      MakeIfMatches<7, 6, 4>(rows, columns, num_to_win, game)) {
+    return game;
+  }
+  throw std::invalid_argument(
+      "No ConnectX game with " + std::to_string(rows) + " rows, " +
+      std::to_string(columns) + " columns and " + std::to_string(num_to_win) +
+      " to win is compiled in");
 }
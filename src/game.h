@@ -1,6 +1,11 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include "fixed_game.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -9,11 +14,26 @@ struct StateAndPlayer {
   int player;
 };
 
+// A 64-bit hash of a board's cells. Never returns zero, so zero can mark the
+// empty slots of hash tables keyed by boards.
+uint64_t HashBoard(const int* cells, size_t num_cells);
+inline uint64_t HashBoard(const std::vector<int>& board) {
+  return HashBoard(board.data(), board.size());
+}
+
 class ConnectXGame {
  public:
+  using Board = std::vector<int>;
+
+  virtual ~ConnectXGame() = default;
   virtual std::vector<int> GetInitBoard() const = 0;
   virtual StateAndPlayer GetNextState(const std::vector<int>& board, int player,
                                       int action) const = 0;
+  // In-place counterparts of GetNextState and GetCanonicalBoard. Search uses
+  // these to walk a single scratch board down the tree without allocating.
+  virtual void PlayMove(std::vector<int>& board, int player,
+                        int action) const = 0;
+  virtual void MakeCanonical(std::vector<int>& board, int player) const = 0;
   virtual std::vector<int> GetValidMoves(
       const std::vector<int>& board) const = 0;
   virtual bool HasLegalMoves(const std::vector<int>& board) const = 0;
@@ -24,28 +44,80 @@ class ConnectXGame {
                                              int player) const = 0;
 };
 
-class Connect2Game : public ConnectXGame {
+// Exposes a FixedConnectXGame through the ConnectXGame interface, copying
+// boards between std::vector and std::array on the way in and out.
+template <typename FixedGame>
+class ConnectXGameAdapter : public ConnectXGame {
  public:
-  Connect2Game() : rows(1), columns(4), num_to_win(2) {}
+  int GetBoardSize() const { return FixedGame::kBoardSize; }
+  int GetActionSize() const { return FixedGame::kActionSize; }
 
-  int GetBoardSize() { return rows * columns; }
-  int GetActionSize() { return rows * columns; }
+  std::vector<int> GetInitBoard() const override {
+    return ToVector(FixedGame::GetInitBoard());
+  }
 
-  std::vector<int> GetInitBoard() const override;
   StateAndPlayer GetNextState(const std::vector<int>& board, int player,
-                              int action) const override;
-  std::vector<int> GetValidMoves(const std::vector<int>& board) const override;
-  bool HasLegalMoves(const std::vector<int>& board) const override;
-  bool IsWin(const std::vector<int>& board, int player) const override;
+                              int action) const override {
+    auto next = FixedGame::GetNextState(ToFixed(board), player, action);
+    return {ToVector(next.board), next.player};
+  }
+
+  void PlayMove(std::vector<int>& board, int player,
+                int action) const override {
+    auto fixed_board = ToFixed(board);
+    FixedGame::PlayMove(fixed_board, player, action);
+    std::copy(fixed_board.begin(), fixed_board.end(), board.begin());
+  }
+
+  void MakeCanonical(std::vector<int>& board, int player) const override {
+    auto fixed_board = ToFixed(board);
+    FixedGame::MakeCanonical(fixed_board, player);
+    std::copy(fixed_board.begin(), fixed_board.end(), board.begin());
+  }
+
+  std::vector<int> GetValidMoves(
+      const std::vector<int>& board) const override {
+    return ToVector(FixedGame::GetValidMoves(ToFixed(board)));
+  }
+
+  bool HasLegalMoves(const std::vector<int>& board) const override {
+    return FixedGame::HasLegalMoves(ToFixed(board));
+  }
+
+  bool IsWin(const std::vector<int>& board, int player) const override {
+    return FixedGame::IsWin(ToFixed(board), player);
+  }
+
   std::optional<int> GetRewardForPlayer(const std::vector<int>& board,
-                                        int player) const override;
+                                        int player) const override {
+    return FixedGame::GetRewardForPlayer(ToFixed(board), player);
+  }
+
   std::vector<int> GetCanonicalBoard(const std::vector<int>& board,
-                                     int player) const override;
+                                     int player) const override {
+    return ToVector(FixedGame::GetCanonicalBoard(ToFixed(board), player));
+  }
 
  private:
-  int rows = 0;        // The number of rows on our board
-  int columns = 0;     // The number of columns on our board
-  int num_to_win = 0;  // The required number of adjacent tokens to win
+  static typename FixedGame::Board ToFixed(const std::vector<int>& board) {
+    typename FixedGame::Board fixed_board;
+    std::copy_n(board.begin(), fixed_board.size(), fixed_board.begin());
+    return fixed_board;
+  }
+
+  template <typename Array>
+  static std::vector<int> ToVector(const Array& array) {
+    return std::vector<int>(array.begin(), array.end());
+  }
 };
 
+class Connect2Game : public ConnectXGameAdapter<FixedConnect2Game> {};
+class Connect4Game : public ConnectXGameAdapter<FixedConnect4Game> {};
+
+// The game with these dimensions, for tools that take them at run time. Only
+// the configurations compiled into game.cpp are available; any other throws
+// std::invalid_argument.
+std::unique_ptr<ConnectXGame> MakeConnectXGame(int rows, int columns,
+                                               int num_to_win);
+
 #endif /* GAME_H */
\ No newline at end of file
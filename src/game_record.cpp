@@ -0,0 +1,186 @@
+#include "game_record.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char kGameRecordMagic[8] = {'A', 'Z', 'G', 'A', 'M', 'E', 'S', '\0'};
+const uint32_t kGameRecordVersion = 1;
+
+template <typename T>
+void Append(std::string& buffer, T value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T Consume(const std::vector<char>& chunk, size_t& offset) {
+  if (offset + sizeof(T) > chunk.size()) {
+    throw std::runtime_error("Corrupt game record chunk");
+  }
+  T value;
+  std::memcpy(&value, chunk.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
+}  // namespace
+
+std::vector<uint16_t> QuantizeVisitCounts(const std::vector<float>& counts) {
+  const float kMaxCount = 65535;
+  float max_count = counts.empty()
+                        ? 0
+                        : *std::max_element(counts.begin(), counts.end());
+  float scale = max_count > kMaxCount ? kMaxCount / max_count : 1;
+
+  std::vector<uint16_t> quantized(counts.size());
+  std::transform(counts.begin(), counts.end(), quantized.begin(),
+                 [scale](float count) -> uint16_t {
+                   return std::lround(count * scale);
+                 });
+  return quantized;
+}
+
+GameRecordWriter::GameRecordWriter(const std::string& path,
+                                   int games_per_chunk)
+    : file_(path, std::ios::binary | std::ios::app),
+      games_per_chunk_(games_per_chunk) {
+  if (!file_) {
+    throw std::runtime_error("Could not open " + path);
+  }
+}
+
+GameRecordWriter::~GameRecordWriter() { Flush(); }
+
+void GameRecordWriter::Add(const GameRecord& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Append<uint16_t>(buffer_, record.action_size);
+  Append<uint16_t>(buffer_, record.moves.size());
+  Append<int8_t>(buffer_, record.result);
+  buffer_.append(record.moves.begin(), record.moves.end());
+  for (const auto& counts : record.visit_counts) {
+    buffer_.append(reinterpret_cast<const char*>(counts.data()),
+                   counts.size() * sizeof(uint16_t));
+  }
+
+  if (++games_in_buffer_ >= games_per_chunk_ ||
+      buffer_.size() >= kMaxGameRecordChunkSize / 2) {
+    FlushLocked_();
+  }
+}
+
+void GameRecordWriter::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FlushLocked_();
+}
+
+void GameRecordWriter::FlushLocked_() {
+  if (games_in_buffer_ == 0) {
+    return;
+  }
+
+  // The fastest setting still shrinks the mostly-zero visit counts severalfold
+  uLongf compressed_size = compressBound(buffer_.size());
+  std::vector<Bytef> compressed(compressed_size);
+  if (compress2(compressed.data(), &compressed_size,
+                reinterpret_cast<const Bytef*>(buffer_.data()),
+                buffer_.size(), Z_BEST_SPEED) != Z_OK) {
+    throw std::runtime_error("Could not compress game records");
+  }
+
+  GameRecordChunkHeader header;
+  std::memcpy(header.magic, kGameRecordMagic, sizeof(kGameRecordMagic));
+  header.version = kGameRecordVersion;
+  header.num_games = games_in_buffer_;
+  header.raw_size = buffer_.size();
+  header.compressed_size = compressed_size;
+
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.write(reinterpret_cast<const char*>(compressed.data()),
+              compressed_size);
+  file_.flush();
+
+  buffer_.clear();
+  games_in_buffer_ = 0;
+}
+
+GameRecordReader::GameRecordReader(const std::string& path)
+    : file_(path, std::ios::binary | std::ios::ate) {
+  if (!file_) {
+    throw std::runtime_error("Could not open " + path);
+  }
+  file_size_ = file_.tellg();
+  file_.seekg(0);
+}
+
+bool GameRecordReader::Next(GameRecord& record) {
+  while (games_left_ == 0) {
+    if (!ReadChunk_()) {
+      return false;
+    }
+  }
+  --games_left_;
+
+  record.action_size = Consume<uint16_t>(chunk_, offset_);
+  auto num_moves = Consume<uint16_t>(chunk_, offset_);
+  record.result = Consume<int8_t>(chunk_, offset_);
+
+  record.moves.resize(num_moves);
+  for (auto& move : record.moves) {
+    move = Consume<uint8_t>(chunk_, offset_);
+  }
+  record.visit_counts.assign(num_moves,
+                             std::vector<uint16_t>(record.action_size));
+  for (auto& counts : record.visit_counts) {
+    for (auto& count : counts) {
+      count = Consume<uint16_t>(chunk_, offset_);
+    }
+  }
+  return true;
+}
+
+bool GameRecordReader::ReadChunk_() {
+  GameRecordChunkHeader header;
+  if (!file_.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    return false;
+  }
+  if (std::memcmp(header.magic, kGameRecordMagic, sizeof(kGameRecordMagic)) !=
+          0 ||
+      header.version != kGameRecordVersion) {
+    throw std::runtime_error("Not a game record file");
+  }
+  // Sizes are checked before allocating, so that a corrupt header can't ask
+  // for more memory than the file could ever decompress to
+  if (header.raw_size > kMaxGameRecordChunkSize) {
+    throw std::runtime_error("Corrupt game record chunk");
+  }
+  uint64_t remaining = file_size_ - static_cast<uint64_t>(file_.tellg());
+  if (header.compressed_size > remaining) {
+    // The writer was interrupted part way through this chunk
+    return false;
+  }
+
+  std::vector<Bytef> compressed(header.compressed_size);
+  if (!file_.read(reinterpret_cast<char*>(compressed.data()),
+                  compressed.size())) {
+    // The writer was interrupted part way through this chunk
+    return false;
+  }
+
+  chunk_.resize(header.raw_size);
+  uLongf raw_size = header.raw_size;
+  if (uncompress(reinterpret_cast<Bytef*>(chunk_.data()), &raw_size,
+                 compressed.data(), compressed.size()) != Z_OK ||
+      raw_size != header.raw_size) {
+    throw std::runtime_error("Corrupt game record chunk");
+  }
+
+  offset_ = 0;
+  games_left_ = header.num_games;
+  return true;
+}
@@ -0,0 +1,133 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include "example.h"
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A self-play game stored as its moves rather than its positions. The boards
+// and training targets are regenerated by replaying the moves.
+struct GameRecord {
+  int action_size = 0;
+  std::vector<uint8_t> moves;
+  // The policy target of each move before normalization, as written by
+  // QuantizeVisitCounts
+  std::vector<std::vector<uint16_t>> visit_counts;
+  // The reward of the first player: 1 win, 0 draw, -1 loss
+  int8_t result = 0;
+};
+
+// Scales visit counts down to fit uint16_t if they have to, which leaves the
+// normalized distribution almost unchanged.
+std::vector<uint16_t> QuantizeVisitCounts(const std::vector<float>& counts);
+
+// On-disk layout: a sequence of chunks, each this header followed by
+// compressed_size bytes of zlib-compressed games. Each game is its uint16_t
+// action_size, uint16_t number of moves and int8_t result, then one uint8_t
+// per move and action_size uint16_t visit counts per move.
+struct GameRecordChunkHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_games;
+  uint64_t raw_size;
+  uint64_t compressed_size;
+};
+
+// Writers start a new chunk before a chunk's games reach this size, and
+// readers reject chunks claiming to be larger
+constexpr uint64_t kMaxGameRecordChunkSize = uint64_t{1} << 26;
+
+// Appends games to a file in chunks of games_per_chunk, so that a file
+// interrupted mid-write loses at most the last chunk. Add may be called from
+// several self-play workers at once.
+class GameRecordWriter {
+ public:
+  explicit GameRecordWriter(const std::string& path, int games_per_chunk = 256);
+  ~GameRecordWriter();
+
+  GameRecordWriter(const GameRecordWriter&) = delete;
+  GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+
+  void Add(const GameRecord& record);
+  // Writes out any buffered games as a final, possibly short, chunk
+  void Flush();
+
+ private:
+  std::mutex mutex_;
+  std::ofstream file_;
+  std::string buffer_;
+  int games_in_buffer_ = 0;
+  int games_per_chunk_;
+
+  void FlushLocked_();
+};
+
+// Streams the games of a file written by GameRecordWriter, decompressing one
+// chunk at a time. A truncated chunk at the end of the file is ignored.
+class GameRecordReader {
+ public:
+  explicit GameRecordReader(const std::string& path);
+
+  // Reads the next game into record, returning false once there are none left
+  bool Next(GameRecord& record);
+
+ private:
+  std::ifstream file_;
+  uint64_t file_size_ = 0;
+  std::vector<char> chunk_;
+  size_t offset_ = 0;
+  uint32_t games_left_ = 0;
+
+  bool ReadChunk_();
+};
+
+// Replays a game and appends an Example for every move, identical to the ones
+// the trainer built while playing it. Throws if the record is of a game with
+// another action size or has a move the game doesn't allow.
+template <typename Game>
+void AppendExamples(const Game& game, const GameRecord& record,
+                    std::vector<Example>& examples) {
+  int current_player = 1;
+  auto state = game.GetInitBoard();
+  int action_size = game.GetValidMoves(state).size();
+  if (record.action_size != action_size ||
+      record.visit_counts.size() != record.moves.size()) {
+    throw std::runtime_error("Game record is of another game");
+  }
+
+  for (size_t i = 0; i < record.moves.size(); ++i) {
+    if (record.moves[i] >= action_size ||
+        record.visit_counts[i].size() != static_cast<size_t>(action_size) ||
+        game.GetValidMoves(state)[record.moves[i]] == 0) {
+      throw std::runtime_error("Game record has an illegal move");
+    }
+    auto canonical_board = game.GetCanonicalBoard(state, current_player);
+
+    const auto& counts = record.visit_counts[i];
+    std::vector<float> action_probs(counts.begin(), counts.end());
+    const float kEps = 1e-9;
+    float sum_of_counts =
+        std::accumulate(action_probs.begin(), action_probs.end(), 0.0) + kEps;
+    for (auto& prob : action_probs) {
+      prob /= sum_of_counts;
+    }
+
+    examples.push_back(
+        {std::vector<int>(canonical_board.begin(), canonical_board.end()),
+         current_player, std::move(action_probs),
+         static_cast<float>(record.result * current_player)});
+
+    auto state_and_player =
+        game.GetNextState(state, current_player, record.moves[i]);
+    state = state_and_player.board;
+    current_player = state_and_player.player;
+  }
+}
+
+#endif /* GAME_RECORD_H */
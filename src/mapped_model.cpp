@@ -0,0 +1,159 @@
+#include "mapped_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+void Relu(float* values, int size) {
+  for (int i = 0; i < size; ++i) {
+    values[i] = std::max(values[i], 0.0f);
+  }
+}
+
+}  // namespace
+
+void DenseLayerScalar(const float* weights, const float* bias,
+                      const float* input, int num_inputs, int num_outputs,
+                      float* out) {
+  for (int i = 0; i < num_outputs; ++i) {
+    const float* row = weights + static_cast<size_t>(i) * num_inputs;
+    float sum = 0;
+    for (int j = 0; j < num_inputs; ++j) {
+      sum += row[j] * input[j];
+    }
+    out[i] = sum + bias[i];
+  }
+}
+
+#if defined(__SSE2__)
+namespace {
+
+template <bool kAlignedRows>
+void DenseLayerSse2(const float* weights, const float* bias,
+                    const float* input, int num_inputs, int num_outputs,
+                    float* out) {
+  for (int i = 0; i < num_outputs; ++i) {
+    const float* row = weights + static_cast<size_t>(i) * num_inputs;
+    __m128 sum4 = _mm_setzero_ps();
+    int j = 0;
+    for (; j + 4 <= num_inputs; j += 4) {
+      __m128 weights4 =
+          kAlignedRows ? _mm_load_ps(row + j) : _mm_loadu_ps(row + j);
+      sum4 = _mm_add_ps(sum4, _mm_mul_ps(weights4, _mm_loadu_ps(input + j)));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, sum4);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; j < num_inputs; ++j) {
+      sum += row[j] * input[j];
+    }
+    out[i] = sum + bias[i];
+  }
+}
+
+}  // namespace
+#endif
+
+void DenseLayer(const float* weights, const float* bias, const float* input,
+                int num_inputs, int num_outputs, float* out) {
+#if defined(__SSE2__)
+  // Weight files align every tensor, so every row is aligned too whenever
+  // rows are a whole number of vectors long
+  if (reinterpret_cast<uintptr_t>(weights) % 16 == 0 && num_inputs % 4 == 0) {
+    DenseLayerSse2<true>(weights, bias, input, num_inputs, num_outputs, out);
+  } else {
+    DenseLayerSse2<false>(weights, bias, input, num_inputs, num_outputs, out);
+  }
+#else
+  DenseLayerScalar(weights, bias, input, num_inputs, num_outputs, out);
+#endif
+}
+
+MappedConnect2Model::MappedConnect2Model(const std::string& path,
+                                         int board_size, int action_size)
+    : Evaluator(board_size, action_size), weights_(path) {
+  auto fc1_shape = weights_.GetShape("fc1.weight");
+  if (fc1_shape.size() != 2) {
+    throw std::runtime_error("fc1.weight must be a matrix");
+  }
+  hidden_size_ = fc1_shape[0];
+
+  int64_t hidden = hidden_size_;
+  fc1_weight_ = weights_.Get("fc1.weight", {hidden, board_size});
+  fc1_bias_ = weights_.Get("fc1.bias", {hidden});
+  fc2_weight_ = weights_.Get("fc2.weight", {hidden, hidden});
+  fc2_bias_ = weights_.Get("fc2.bias", {hidden});
+  action_head_weight_ =
+      weights_.Get("action_head.weight", {action_size, hidden});
+  action_head_bias_ = weights_.Get("action_head.bias", {action_size});
+  value_head_weight_ = weights_.Get("value_head.weight", {1, hidden});
+  value_head_bias_ = weights_.Get("value_head.bias", {1});
+}
+
+ActionProbsAndValue MappedConnect2Model::predict(std::vector<int>& board) {
+  auto result = predict_logits(board);
+  auto& probs = result.action_logits;
+  float max_logit = *std::max_element(probs.begin(), probs.end());
+  float sum = 0;
+  for (auto& prob : probs) {
+    prob = std::exp(prob - max_logit);
+    sum += prob;
+  }
+  for (auto& prob : probs) {
+    prob /= sum;
+  }
+  return {std::move(probs), result.value};
+}
+
+ActionLogitsAndValue MappedConnect2Model::predict_logits(
+    std::vector<int>& board) {
+  auto result = predict_batch(board.data(), 1);
+  return {std::vector<float>(result.action_logits,
+                             result.action_logits + action_size),
+          result.values[0]};
+}
+
+BatchPrediction MappedConnect2Model::predict_batch(const int* boards,
+                                                   int batch_size) {
+  auto& buffers = buffers_.Get();
+  auto& input = buffers.input;
+  auto& hidden1 = buffers.hidden1;
+  auto& hidden2 = buffers.hidden2;
+  auto& action_logits = buffers.action_logits;
+  auto& values = buffers.values;
+  input.resize(board_size);
+  hidden1.resize(hidden_size_);
+  hidden2.resize(hidden_size_);
+  action_logits.resize(static_cast<size_t>(batch_size) * action_size);
+  values.resize(batch_size);
+
+  for (int i = 0; i < batch_size; ++i) {
+    const int* board = boards + static_cast<size_t>(i) * board_size;
+    std::copy(board, board + board_size, input.begin());
+
+    DenseLayer(fc1_weight_, fc1_bias_, input.data(), board_size, hidden_size_,
+               hidden1.data());
+    Relu(hidden1.data(), hidden_size_);
+    DenseLayer(fc2_weight_, fc2_bias_, hidden1.data(), hidden_size_,
+               hidden_size_, hidden2.data());
+    Relu(hidden2.data(), hidden_size_);
+
+    DenseLayer(action_head_weight_, action_head_bias_, hidden2.data(),
+               hidden_size_, action_size,
+               action_logits.data() + static_cast<size_t>(i) * action_size);
+    float value_logit;
+    DenseLayer(value_head_weight_, value_head_bias_, hidden2.data(),
+               hidden_size_, 1, &value_logit);
+    values[i] = std::tanh(value_logit);
+  }
+
+  return {action_logits.data(), values.data(), batch_size, action_size};
+}
@@ -0,0 +1,59 @@
+#ifndef MAPPED_MODEL_H
+#define MAPPED_MODEL_H
+
+#include "evaluator.h"
+#include "weight_file.h"
+
+#include <string>
+#include <vector>
+
+// Computes out[i] = bias[i] + dot(weights row i, input) for each of the
+// num_outputs rows of a [num_outputs, num_inputs] matrix.
+void DenseLayer(const float* weights, const float* bias, const float* input,
+                int num_inputs, int num_outputs, float* out);
+// Same as DenseLayer but with a plain loop. Kept as the reference
+// implementation.
+void DenseLayerScalar(const float* weights, const float* bias,
+                      const float* input, int num_inputs, int num_outputs,
+                      float* out);
+
+// Inference-only Connect2Model that reads its weights straight out of a
+// memory-mapped weight file. Loading one copies nothing, so any number of
+// self-play processes can start from the same file and share a single copy of
+// the weights through the page cache. Runs on the CPU without libtorch; see
+// ExportWeights for writing the file.
+class MappedConnect2Model : public Evaluator {
+ public:
+  MappedConnect2Model(const std::string& path, int board_size,
+                      int action_size);
+
+  ActionProbsAndValue predict(std::vector<int>& board) override;
+  ActionLogitsAndValue predict_logits(std::vector<int>& board) override;
+  // Evaluated one board at a time, straight from the mapping
+  BatchPrediction predict_batch(const int* boards, int batch_size) override;
+
+  int GetHiddenSize() const { return hidden_size_; }
+
+ private:
+  WeightFile weights_;
+  int hidden_size_;
+  const float* fc1_weight_;
+  const float* fc1_bias_;
+  const float* fc2_weight_;
+  const float* fc2_bias_;
+  const float* action_head_weight_;
+  const float* action_head_bias_;
+  const float* value_head_weight_;
+  const float* value_head_bias_;
+
+  struct MappedModelBuffers {
+    std::vector<float> input;
+    std::vector<float> hidden1;
+    std::vector<float> hidden2;
+    std::vector<float> action_logits;
+    std::vector<float> values;
+  };
+  ThreadBuffers<MappedModelBuffers> buffers_;
+};
+
+#endif /* MAPPED_MODEL_H */
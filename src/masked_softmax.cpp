@@ -0,0 +1,132 @@
+#include "masked_softmax.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Copies out the legal actions and their logits, skipping any at -inf
+int GatherLegalLogits(const float* logits, uint64_t legal_moves, int* actions,
+                      float* gathered) {
+  int count = 0;
+  while (legal_moves != 0) {
+    int action = __builtin_ctzll(legal_moves);
+    legal_moves &= legal_moves - 1;
+    if (logits[action] == -std::numeric_limits<float>::infinity()) {
+      continue;
+    }
+    actions[count] = action;
+    gathered[count] = logits[action];
+    ++count;
+  }
+  return count;
+}
+
+#if defined(__SSE2__)
+// exp for four lanes with the range reduction and polynomial from Cephes.
+// Relative error is within a few float ulps over the clamped range.
+inline __m128 Exp4(__m128 x) {
+  x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+  x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+  // x = n * ln(2) + r, with |r| <= ln(2) / 2
+  __m128 n = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)),
+                        _mm_set1_ps(0.5f));
+  __m128i n_int = _mm_cvttps_epi32(n);
+  __m128 n_floor = _mm_cvtepi32_ps(n_int);
+  // Truncation rounds towards zero, so step back for negative n
+  __m128 too_big = _mm_cmpgt_ps(n_floor, n);
+  n_floor = _mm_sub_ps(n_floor, _mm_and_ps(too_big, _mm_set1_ps(1.0f)));
+  n_int = _mm_cvttps_epi32(n_floor);
+
+  x = _mm_sub_ps(x, _mm_mul_ps(n_floor, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(n_floor, _mm_set1_ps(-2.12194440e-4f)));
+
+  __m128 x2 = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(1.9875691500E-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x2), x);
+  y = _mm_add_ps(y, _mm_set1_ps(1.0f));
+
+  // Multiply by 2^n by building the float directly from its exponent bits
+  __m128i exponent = _mm_slli_epi32(_mm_add_epi32(n_int, _mm_set1_epi32(127)),
+                                    23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+}
+#endif
+
+}  // namespace
+
+int MaskedSoftmaxScalar(const float* logits, uint64_t legal_moves,
+                        int* actions, float* priors) {
+  int count = GatherLegalLogits(logits, legal_moves, actions, priors);
+  if (count == 0) {
+    return 0;
+  }
+
+  float max_logit = *std::max_element(priors, priors + count);
+  float sum = 0;
+  for (int i = 0; i < count; ++i) {
+    priors[i] = std::exp(priors[i] - max_logit);
+    sum += priors[i];
+  }
+  for (int i = 0; i < count; ++i) {
+    priors[i] /= sum;
+  }
+  return count;
+}
+
+int MaskedSoftmax(const float* logits, uint64_t legal_moves, int* actions,
+                  float* priors) {
+#if defined(__SSE2__)
+  // Work in a buffer padded to whole vectors, so there is no scalar tail
+  alignas(16) float values[64];
+  int count = GatherLegalLogits(logits, legal_moves, actions, values);
+  if (count == 0) {
+    return 0;
+  }
+  int padded_count = (count + 3) & ~3;
+  std::fill(values + count, values + padded_count,
+            -std::numeric_limits<float>::max());
+
+  __m128 max4 = _mm_load_ps(values);
+  for (int i = 4; i < padded_count; i += 4) {
+    max4 = _mm_max_ps(max4, _mm_load_ps(values + i));
+  }
+  max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 0, 3, 2)));
+  max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  // Padding lanes are masked out of the sum
+  const __m128i lane4 = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128i count4 = _mm_set1_epi32(count);
+  __m128 sum4 = _mm_setzero_ps();
+  for (int i = 0; i < padded_count; i += 4) {
+    __m128 in_range = _mm_castsi128_ps(
+        _mm_cmplt_epi32(_mm_add_epi32(lane4, _mm_set1_epi32(i)), count4));
+    __m128 exp4 = _mm_and_ps(in_range,
+                             Exp4(_mm_sub_ps(_mm_load_ps(values + i), max4)));
+    _mm_store_ps(values + i, exp4);
+    sum4 = _mm_add_ps(sum4, exp4);
+  }
+  sum4 = _mm_add_ps(sum4, _mm_shuffle_ps(sum4, sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum4 = _mm_add_ps(sum4, _mm_shuffle_ps(sum4, sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  __m128 inverse_sum4 = _mm_div_ps(_mm_set1_ps(1.0f), sum4);
+  for (int i = 0; i < padded_count; i += 4) {
+    _mm_store_ps(values + i, _mm_mul_ps(_mm_load_ps(values + i), inverse_sum4));
+  }
+  std::copy(values, values + count, priors);
+  return count;
+#else
+  return MaskedSoftmaxScalar(logits, legal_moves, actions, priors);
+#endif
+}
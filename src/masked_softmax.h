@@ -0,0 +1,32 @@
+#ifndef MASKED_SOFTMAX_H
+#define MASKED_SOFTMAX_H
+
+#include <cstdint>
+
+// Bit i is set when action i is legal, so action spaces are at most 64 wide
+template <typename ValidMoves>
+uint64_t GetLegalMoveMask(const ValidMoves& valid_moves) {
+  uint64_t mask = 0;
+  for (int action = 0; action < static_cast<int>(valid_moves.size());
+       ++action) {
+    if (valid_moves[action] != 0) {
+      mask |= uint64_t(1) << action;
+    }
+  }
+  return mask;
+}
+
+// Softmax over the logits of the legal actions alone, subtracting the largest
+// of them first so that no exponent overflows. The legal actions, in
+// increasing order, and their probabilities are written to actions and priors,
+// which need room for one entry per set bit of legal_moves. Actions with a
+// logit of -inf are skipped. Returns the number of entries written.
+int MaskedSoftmax(const float* logits, uint64_t legal_moves, int* actions,
+                  float* priors);
+
+// Same as MaskedSoftmax but with a plain loop and std::exp. Kept as the
+// reference implementation.
+int MaskedSoftmaxScalar(const float* logits, uint64_t legal_moves,
+                        int* actions, float* priors);
+
+#endif /* MASKED_SOFTMAX_H */
@@ -1,8 +1,12 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include "evaluator.h"
+
 #include <torch/torch.h>
 
+#include <algorithm>
+
 // During training, we need to keep a copy of the original tensors
 // so we can create a loss and backprop through everything.
 struct ActionProbsAndValueTensor {
@@ -10,22 +14,59 @@ struct ActionProbsAndValueTensor {
   torch::Tensor value;
 };
 
-// During prediction, we simply want the raw numerical values for
-// actionProbs and our value.
-struct ActionProbsAndValue {
-  std::vector<float> action_probs;
-  float value;
+struct ActionLogitsAndValueTensor {
+  torch::Tensor action_logits;
+  torch::Tensor value;
 };
 
-struct Model {
-  Model(int board_size, int action_size)
-      : board_size(board_size), action_size(action_size) {}
+// Tensors reused by every predict_batch call of one model on a thread. The
+// input only ever grows, so after the first few calls no memory is allocated
+// for it.
+struct TorchBatchBuffers {
+  // [capacity, board_size] floats, pinned when the model runs on a GPU so
+  // that the copy to the device can be asynchronous
+  torch::Tensor input;
+  // The outputs of the last call, on the CPU
+  torch::Tensor action_logits;
+  torch::Tensor values;
+
+  // Converts the boards to floats in the input buffer and returns them as a
+  // batch on the device
+  torch::Tensor FillInput(const int* boards, int batch_size, int board_size,
+                          torch::Device device) {
+    bool pinned = device.is_cuda();
+    if (!input.defined() || input.size(0) < batch_size ||
+        input.size(1) != board_size || input.is_pinned() != pinned) {
+      input = torch::empty(
+          {batch_size, board_size},
+          torch::TensorOptions().dtype(torch::kFloat32).pinned_memory(pinned));
+    }
+
+    std::copy(boards, boards + batch_size * board_size,
+              input.data_ptr<float>());
+    auto batch = input.narrow(0, 0, batch_size);
+    return pinned ? batch.to(torch::TensorOptions().device(device),
+                             /*non_blocking=*/true)
+                  : batch;
+  }
+
+  BatchPrediction StoreOutput(const ActionLogitsAndValueTensor& result,
+                              int batch_size, int action_size) {
+    action_logits = result.action_logits.to(torch::kCPU).contiguous();
+    values = result.value.to(torch::kCPU).contiguous();
+    return {action_logits.data_ptr<float>(), values.data_ptr<float>(),
+            batch_size, action_size};
+  }
+};
 
-  int board_size;
-  int action_size;
+// An Evaluator backed by a libtorch network that can also be trained
+struct Model : Evaluator {
+  using Evaluator::Evaluator;
 
   virtual ActionProbsAndValueTensor forward(const torch::Tensor& input) = 0;
-  virtual ActionProbsAndValue predict(std::vector<int>& board) = 0;
+
+ protected:
+  ThreadBuffers<TorchBatchBuffers> torch_batch_buffers_;
 };
 
 struct Connect2Model : torch::nn::Module, Model {
@@ -41,16 +82,22 @@ struct Connect2Model : torch::nn::Module, Model {
   }
 
   ActionProbsAndValueTensor forward(const torch::Tensor& input) override {
+    auto result = forward_logits(input);
+    auto action_probs = torch::softmax(result.action_logits, 1);
+
+    return {action_probs, result.value};
+  }
+
+  ActionLogitsAndValueTensor forward_logits(const torch::Tensor& input) {
     auto x = torch::relu(fc1(input));
     x = torch::relu(fc2(x));
 
     auto action_logits = action_head(x);
     auto value_logit = value_head(x);
 
-    auto action_probs = torch::softmax(action_logits, 1);
     auto value = torch::tanh(value_logit);
 
-    return {action_probs, value};
+    return {action_logits, value};
   }
 
   ActionProbsAndValue predict(std::vector<int>& board) override {
@@ -76,6 +123,23 @@ struct Connect2Model : torch::nn::Module, Model {
     return {action_probs, value};
   }
 
+  ActionLogitsAndValue predict_logits(std::vector<int>& board) override {
+    auto result = predict_batch(board.data(), 1);
+    return {std::vector<float>(result.action_logits,
+                               result.action_logits + action_size),
+            result.values[0]};
+  }
+
+  BatchPrediction predict_batch(const int* boards, int batch_size) override {
+    this->eval();
+    torch::NoGradGuard guard;
+
+    auto& buffers = torch_batch_buffers_.Get();
+    auto input = buffers.FillInput(boards, batch_size, board_size, device);
+    return buffers.StoreOutput(this->forward_logits(input), batch_size,
+                               action_size);
+  }
+
   torch::Device device;
 
   torch::nn::Linear fc1;
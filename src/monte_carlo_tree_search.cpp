@@ -1,9 +1,28 @@
+#include <masked_softmax.h>
 #include <monte_carlo_tree_search.h>
+#include <puct.h>
+#include <opening_book.h>
+#include <tablebase.h>
+#include <tracer.h>
 
+#include <algorithm>
+#include <cmath>
 #include <random>
+#include <stdexcept>
+
+std::atomic<int64_t> Node::num_live_nodes_(0);
 
 Node::Node(float prior, int to_play, int action)
-    : prior_(prior), to_play_(to_play), action_(action) {}
+    : to_play_(to_play), action_(action), prior_(prior) {
+  num_live_nodes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+Node::~Node() { num_live_nodes_.fetch_sub(1, std::memory_order_relaxed); }
+
+size_t Node::GetBytesPerNode() {
+  return sizeof(Node) + sizeof(std::unique_ptr<Node>) + 2 * sizeof(float) +
+         2 * sizeof(int);
+}
 
 bool Node::IsExpanded() { return Children.size() > 0; }
 
@@ -12,163 +31,538 @@ float Node::GetValue() {
 }
 
 int Node::SelectAction(float temperature) {
-  std::vector<int> actions, visit_counts;
-
-  int max_action = -1, max_visit_count = -1;
+  if (proven_value_ == ProvenValue::kWin) {
+    // A solved win is played regardless of how the visits were spread
+    for (auto& child : Children) {
+      if (child != nullptr && child->proven_value_ == ProvenValue::kLoss) {
+        return child->action_;
+      }
+    }
+  }
 
+  // Children proven to be a win for the opponent are never played while
+  // anything else is left, which in a drawn position means taking the draw
+  std::vector<int> counts(child_visit_counts_);
+  bool has_alternative = false;
   for (size_t i = 0; i < Children.size(); ++i) {
-    Node* child = Children[i].get();
-    actions.push_back(child->action_);
-    visit_counts.push_back(child->visit_count_);
-
-    if (child->visit_count_ > max_visit_count) {
-      max_action = i;
-      max_visit_count = child->visit_count_;
+    if (Children[i] != nullptr &&
+        Children[i]->proven_value_ == ProvenValue::kWin) {
+      counts[i] = -1;
+    } else {
+      has_alternative = true;
     }
   }
+  if (!has_alternative) {
+    counts = child_visit_counts_;
+  }
 
-  if (temperature == 0) {
+  bool any_visits = std::any_of(counts.begin(), counts.end(),
+                                [](int count) { return count > 0; });
+  if (temperature == 0 || !any_visits) {
     // For zero temperature, we select the action with the highest visitCount
-    return actions[max_action];
+    auto max_it = std::max_element(counts.begin(), counts.end());
+    return child_actions_[max_it - counts.begin()];
   } else {
     // otherwise we select randomly from the visitCount distribution
-    std::discrete_distribution<int> distr(visit_counts.begin(),
-                                          visit_counts.end());
+    for (auto& count : counts) {
+      count = std::max(count, 0);
+    }
+    std::discrete_distribution<int> distr(counts.begin(), counts.end());
     int random_index = distr(generator_);
-    return actions[random_index];
+    return child_actions_[random_index];
   }
 }
 
-float Node::UcbScore_(Node* parent, Node* child) {
-  float prior_score =
-      child->prior_ * sqrt(parent->visit_count_) / (child->visit_count_ + 1);
+bool Node::IsBestActionSettled(int remaining_simulations) const {
+  if (child_actions_.size() == 1) {
+    // A forced move can't be overtaken
+    return true;
+  }
 
-  float value_score = 0;
-  if (child->visit_count_ > 0) {
-    // Recall that the child's value is from the perspective of the opposing
-    // player so we must negate it Eg. A win (+1) for the opponent is worth a
-    // loss (-1) for us.
-    value_score = -child->GetValue();
+  int best = 0, second_best = 0;
+  for (auto visit_count : child_visit_counts_) {
+    if (visit_count > best) {
+      second_best = best;
+      best = visit_count;
+    } else if (visit_count > second_best) {
+      second_best = visit_count;
+    }
   }
 
-  return value_score + prior_score;
+  return best > second_best + remaining_simulations;
+}
+
+int Node::SelectChildIndex(float c_puct) const {
+  // Children that haven't been allocated score like any other unvisited child
+  return SelectPuctIndex(child_priors_.data(), child_visit_counts_.data(),
+                         child_value_sums_.data(), num_unproven_children_,
+                         c_puct, std::sqrt(static_cast<float>(visit_count_)));
 }
 
-Node* Node::SelectChild() {
-  // Set best_score to the most negative number we can.
-  float best_score = -std::numeric_limits<float>::max();
-  Node* best_child = Children.front().get();
+Node* Node::GetChild(int child_index) {
+  auto& child = Children[child_index];
+  if (child == nullptr) {
+    child = std::make_unique<Node>(child_priors_[child_index], -to_play_,
+                                   child_actions_[child_index]);
+    child->child_index_ = child_index;
+  }
+  return child.get();
+}
 
-  for (auto& child_ptr : Children) {
-    auto child = child_ptr.get();
-    auto score = this->UcbScore_(this, child);
-    if (score > best_score) {
-      best_score = score;
-      best_child = child;
+std::unique_ptr<Node> Node::ReleaseChildByAction(int action) {
+  for (size_t i = 0; i < child_actions_.size(); ++i) {
+    if (child_actions_[i] == action) {
+      GetChild(i);
+      auto child = std::move(Children[i]);
+      child->child_index_ = -1;
+      return child;
     }
   }
-
-  return best_child;
+  throw "No child with that action: " + std::to_string(action);
 }
 
-void Node::Expand(const std::vector<int>& state, int to_play,
-                  const std::vector<float>& action_probs) {
+int Node::Expand(int to_play, const std::vector<float>& action_probs,
+                 bool lazy) {
   this->to_play_ = to_play;
-  this->state_ = state;
 
   for (size_t action = 0; action < action_probs.size(); ++action) {
     auto prior_prob = action_probs[action];
     if (prior_prob != 0.0f) {
-      auto new_child = std::make_unique<Node>(prior_prob, -to_play, action);
-      this->Children.push_back(std::move(new_child));
+      this->child_actions_.push_back(action);
+      this->child_priors_.push_back(prior_prob);
     }
   }
+
+  return FinishExpand_(lazy);
 }
 
-MCTS::MCTS(ConnectXGame& game, Model& model) : game_(game), model_(model) {}
+int Node::ExpandFromLogits(int to_play, const float* action_logits,
+                           uint64_t legal_moves, bool lazy) {
+  this->to_play_ = to_play;
 
-std::vector<float> MCTS::MaskInvalidMovesAndNormalize(
-    std::vector<float>& action_probs, const std::vector<int>& valid_moves) {
-  // Mask out invalid moves
-  std::transform(action_probs.begin(), action_probs.end(), valid_moves.begin(),
-                 action_probs.begin(), std::multiplies<float>());
+  int num_legal = __builtin_popcountll(legal_moves);
+  child_actions_.resize(num_legal);
+  child_priors_.resize(num_legal);
+  int num_children = MaskedSoftmax(action_logits, legal_moves,
+                                   child_actions_.data(), child_priors_.data());
+  child_actions_.resize(num_children);
+  child_priors_.resize(num_children);
 
-  // Normalize remaining probabilities
-  float kEps = 1e-9;
-  float sum_of_valid_probs =
-      std::accumulate(action_probs.begin(), action_probs.end(), 0.0) + kEps;
+  return FinishExpand_(lazy);
+}
 
-  std::transform(action_probs.begin(), action_probs.end(), action_probs.begin(),
-                 [&sum_of_valid_probs](float prob) -> float {
-                   return prob / sum_of_valid_probs;
-                 });
+int Node::FinishExpand_(bool lazy) {
+  Children.resize(child_actions_.size());
+  child_visit_counts_.assign(child_actions_.size(), 0);
+  child_value_sums_.assign(child_actions_.size(), 0);
+  num_unproven_children_ = child_actions_.size();
 
-  return action_probs;
+  if (lazy) {
+    return 0;
+  }
+  for (size_t i = 0; i < Children.size(); ++i) {
+    GetChild(i);
+  }
+  return Children.size();
 }
 
-Node* MCTS::Run(std::vector<int> state, int to_play,
-                int num_simulations) {
+bool Node::UpdateProvenValueFromChild(int child_index) {
+  if (child_index >= num_unproven_children_) {
+    // Already accounted for
+    return false;
+  }
+
+  if (Children[child_index]->proven_value_ == ProvenValue::kLoss) {
+    // We can move into a position that is lost for the opponent
+    proven_value_ = ProvenValue::kWin;
+    return true;
+  }
+
+  // The child is a win for the opponent or a draw, so there is nothing left
+  // to learn by visiting it.
+  SwapChildren_(child_index, --num_unproven_children_);
+  if (num_unproven_children_ > 0) {
+    return false;
+  }
+
+  // Every child is solved and none of them wins, so take a draw if we can
+  proven_value_ = ProvenValue::kLoss;
+  for (auto& child : Children) {
+    if (child != nullptr && child->proven_value_ == ProvenValue::kDraw) {
+      proven_value_ = ProvenValue::kDraw;
+    }
+  }
+  return true;
+}
+
+int64_t Node::Collapse() {
+  auto num_deleted = CountDescendants();
+  Children.clear();
+  child_actions_.clear();
+  child_priors_.clear();
+  child_visit_counts_.clear();
+  child_value_sums_.clear();
+  num_unproven_children_ = 0;
+  return num_deleted;
+}
+
+int64_t Node::CountDescendants() const {
+  int64_t count = 0;
+  for (auto& child : Children) {
+    if (child != nullptr) {
+      count += 1 + child->CountDescendants();
+    }
+  }
+  return count;
+}
+
+void Node::SwapChildren_(int a, int b) {
+  std::swap(Children[a], Children[b]);
+  std::swap(child_actions_[a], child_actions_[b]);
+  std::swap(child_priors_[a], child_priors_[b]);
+  std::swap(child_visit_counts_[a], child_visit_counts_[b]);
+  std::swap(child_value_sums_[a], child_value_sums_[b]);
+  for (auto index : {a, b}) {
+    if (Children[index] != nullptr) {
+      Children[index]->child_index_ = index;
+    }
+  }
+}
+
+template <typename Game>
+BasicMCTS<Game>::BasicMCTS(const Game& game, Evaluator& model,
+                           MCTSOptions options)
+    : game_(game), model_(model), options_(options) {
+  options_.time_check_interval = std::max(1, options_.time_check_interval);
+  // Games with as many cells but other columns, e.g. 6x7 and 7x6, share
+  // board hashes, so the table would silently return wrong values
+  if (options_.tablebase != nullptr) {
+    auto init_board = game_.GetInitBoard();
+    if (options_.tablebase->GetBoardSize() !=
+            static_cast<int>(init_board.size()) ||
+        options_.tablebase->GetActionSize() !=
+            static_cast<int>(game_.GetValidMoves(init_board).size())) {
+      throw std::invalid_argument("Tablebase was built for another game");
+    }
+  }
+}
+
+template <typename Game>
+BatchPrediction BasicMCTS<Game>::Predict_(const Board& board) {
+  TRACE_SPAN("predict");
+  return model_.predict_batch(board.data(), /*batch_size=*/1);
+}
+
+template <typename Game>
+Node* BasicMCTS<Game>::Run(Board state, int to_play, int num_simulations) {
+  return Run(std::move(state), to_play, num_simulations, num_simulations);
+}
+
+template <typename Game>
+Node* BasicMCTS<Game>::Run(Board state, int to_play, int min_simulations,
+                           int max_simulations) {
   Node* root = new Node(0, to_play, -1);
+  if (!PlayFromBook_(root, state)) {
+    Search_(root, state, min_simulations, max_simulations,
+            Clock::time_point::max(), nullptr);
+  }
+  return root;
+}
 
-  // Expand root
-  auto result = model_.predict(state);
-  auto action_probs = result.action_probs;
-  auto value = result.value;
+template <typename Game>
+Node* BasicMCTS<Game>::RunUntil(Board state, int to_play,
+                                Clock::time_point deadline) {
+  Node* root = new Node(0, to_play, -1);
+  if (!PlayFromBook_(root, state)) {
+    Search_(root, state, kUnlimited, kUnlimited, deadline, nullptr);
+  }
+  return root;
+}
+
+template <typename Game>
+bool BasicMCTS<Game>::PlayFromBook_(Node* root, const Board& state) {
+  if (options_.opening_book == nullptr) {
+    return false;
+  }
+  // Boards of the same size can belong to games with different columns, e.g.
+  // 6x7 and 7x6, whose counts would be read misaligned
   auto valid_moves = this->game_.GetValidMoves(state);
-  action_probs = MaskInvalidMovesAndNormalize(action_probs, valid_moves);
-  root->Expand(state, to_play, action_probs);
+  if (options_.opening_book->GetActionSize() !=
+      static_cast<int>(valid_moves.size())) {
+    return false;
+  }
+  auto entry = options_.opening_book->Lookup(state.data(), state.size());
+  if (!entry.has_value()) {
+    return false;
+  }
+
+  int num_created = SeedRoot(root, entry->visit_counts,
+                             GetLegalMoveMask(valid_moves), valid_moves.size(),
+                             entry->value, options_.lazy_children);
+  if (num_created < 0) {
+    return false;
+  }
+  ++stats_.searches;
+  ++stats_.book_hits;
+  stats_.nodes_created += 1 + num_created;
+  return true;
+}
+
+template <typename Game>
+void BasicMCTS<Game>::Search(Node* root, Board state, int max_simulations,
+                             Clock::time_point deadline,
+                             const std::atomic<bool>* stop) {
+  Search_(root, state, max_simulations, max_simulations, deadline, stop);
+}
+
+template <typename Game>
+void BasicMCTS<Game>::Search_(Node* root, const Board& state,
+                              int min_simulations, int max_simulations,
+                              Clock::time_point deadline,
+                              const std::atomic<bool>* stop) {
+  TRACE_SPAN("mcts_run");
+  float value = 0;
+  num_tree_nodes_ = 1 + root->CountDescendants();
+  if (!root->IsExpanded()) {
+    // Expand root
+    auto result = Predict_(state);
+    auto num_created = root->ExpandFromLogits(
+        root->GetPlayerId(), result.GetActionLogits(0),
+        GetLegalMoveMask(this->game_.GetValidMoves(state)),
+        options_.lazy_children);
+    num_tree_nodes_ += num_created;
+    // A root from an earlier search was counted when it was created
+    stats_.nodes_created += num_created + (root->GetVisitCount() == 0);
+  }
+  // Pruning is only retried once the tree has grown again
+  int64_t num_tree_nodes_after_pruning = 0;
+  bool is_timed = deadline != Clock::time_point::max() || stop != nullptr;
+
+  Board next_state(state);
+
+  int simulation = 0;
+  for (; simulation < max_simulations; ++simulation) {
+    if (root->IsProven()) {
+      // Nothing more to search for once the outcome is known
+      break;
+    }
+
+    if (simulation >= min_simulations &&
+        root->IsBestActionSettled(max_simulations - simulation)) {
+      break;
+    }
+
+    if (is_timed && simulation > 0 &&
+        simulation % options_.time_check_interval == 0 &&
+        ((stop != nullptr && stop->load(std::memory_order_relaxed)) ||
+         Clock::now() >= deadline)) {
+      break;
+    }
+
+    bool can_expand = true;
+    if (IsOverNodeBudget_()) {
+      if (num_tree_nodes_ > num_tree_nodes_after_pruning) {
+        PruneToNodeBudget_(root);
+        num_tree_nodes_after_pruning = num_tree_nodes_;
+      }
+      can_expand = !IsOverNodeBudget_();
+    }
 
-  for (int i = 0; i < num_simulations; ++i) {
     Node* node = root;
     std::vector<Node*> search_path({node});
+    next_state = state;
 
     // SELECT
-    while (node->IsExpanded()) {
-      node = node->SelectChild();
-      search_path.push_back(node);
+    {
+      TRACE_SPAN("select");
+      while (node->IsExpanded()) {
+        auto child_index = node->SelectChildIndex(options_.c_puct);
+        if (!node->HasChild(child_index)) {
+          ++num_tree_nodes_;
+          ++stats_.nodes_created;
+        }
+        node = node->GetChild(child_index);
+        search_path.push_back(node);
+
+        // Players always play from their own perspective
+        this->game_.PlayMove(next_state, /*player=*/1,
+                             /*action=*/node->GetAction());
+        // Get the board from the perspective of the other player
+        this->game_.MakeCanonical(next_state, /*player=*/-1);
+      }
     }
 
     Node* parent = search_path[search_path.size() - 2];
-    state = parent->GetState();
     // Now we're at a leaf node and we would like to expand
-    // Players always play from their own perspective
-    auto next_state_and_player = this->game_.GetNextState(
-        state, /*player=*/1, /*action=*/node->GetAction());
-    auto next_state = next_state_and_player.board;
-    // Get the board from the perspective of the other player
-    next_state = this->game_.GetCanonicalBoard(next_state, /*player=*/-1);
-
     // The value of the new state from the perspective of the other player
     auto opt_value = this->game_.GetRewardForPlayer(next_state, /*player=*/1);
+    if (!opt_value.has_value() && options_.tablebase != nullptr) {
+      opt_value = options_.tablebase->Lookup(next_state.data(),
+                                             next_state.size());
+    }
 
     if (!opt_value.has_value()) {
       // If the game has not ended:
       // EXPAND
-      auto pred = model_.predict(next_state);
-      action_probs = pred.action_probs;
-      value = pred.value;
-      auto valid_moves = this->game_.GetValidMoves(next_state);
-      // Mask and normalize
-      action_probs = MaskInvalidMovesAndNormalize(action_probs, valid_moves);
-      node->Expand(next_state, -parent->GetPlayerId(), action_probs);
+      auto pred = Predict_(next_state);
+      TRACE_SPAN("expand");
+      value = pred.values[0];
+      if (can_expand) {
+        // Priors are normalized over the legal moves only
+        auto num_created = node->ExpandFromLogits(
+            -parent->GetPlayerId(), pred.GetActionLogits(0),
+            GetLegalMoveMask(this->game_.GetValidMoves(next_state)),
+            options_.lazy_children);
+        num_tree_nodes_ += num_created;
+        stats_.nodes_created += num_created;
+      } else {
+        ++stats_.expansions_skipped;
+      }
     } else {
       value = opt_value.value();
+      if (options_.use_solver) {
+        node->SetProvenValue(value > 0   ? ProvenValue::kWin
+                             : value < 0 ? ProvenValue::kLoss
+                                         : ProvenValue::kDraw);
+      }
     }
 
+    TRACE_SPAN("backup");
     this->Backup(search_path, value, -parent->GetPlayerId());
   }
 
-  return root;
+  ++stats_.searches;
+  stats_.peak_tree_nodes =
+      std::max<uint64_t>(stats_.peak_tree_nodes, num_tree_nodes_);
+  stats_.peak_live_nodes =
+      std::max<uint64_t>(stats_.peak_live_nodes, Node::GetNumLiveNodes());
+  stats_.simulations += simulation;
+  if (max_simulations != kUnlimited) {
+    stats_.simulations_saved += max_simulations - simulation;
+  }
 }
 
-void MCTS::Backup(const std::vector<Node*>& search_path, float value, int to_play) {
-  for (auto& node : search_path) {
-    if (node->GetPlayerId() == to_play) {
-      node->AccumulateValue(value);
-    } else {
-      node->AccumulateValue(-value);
-    }
+template <typename Game>
+bool BasicMCTS<Game>::IsOverNodeBudget_() const {
+  return (options_.max_nodes > 0 && num_tree_nodes_ >= options_.max_nodes) ||
+         (options_.max_live_nodes > 0 &&
+          Node::GetNumLiveNodes() >= options_.max_live_nodes);
+}
+
+template <typename Game>
+void BasicMCTS<Game>::PruneToNodeBudget_(Node* root) {
+  TRACE_SPAN("prune");
+  int64_t num_nodes = 0;
+  if (options_.max_nodes > 0) {
+    num_nodes = num_tree_nodes_ - options_.max_nodes * 3 / 4;
+  }
+  if (options_.max_live_nodes > 0) {
+    num_nodes = std::max(num_nodes, Node::GetNumLiveNodes() -
+                                        options_.max_live_nodes * 3 / 4);
+  }
+
+  auto num_deleted = PruneTree(root, num_nodes);
+  num_tree_nodes_ -= num_deleted;
+  stats_.nodes_pruned += num_deleted;
+}
 
+void MCTSBase::Backup(const std::vector<Node*>& search_path, float value, int to_play) {
+  for (size_t i = 0; i < search_path.size(); ++i) {
+    Node* node = search_path[i];
+    float node_value = node->GetPlayerId() == to_play ? value : -value;
+
+    node->AccumulateValue(node_value);
     node->IncrementVisitCount();
+
+    // Keep the parent's contiguous copy of this child's statistics in sync
+    if (i > 0 && node->child_index_ >= 0) {
+      search_path[i - 1]->RecordChildVisit(node->child_index_, node_value);
+    }
+  }
+
+  // Propagate proven values minimax-style from the leaf towards the root,
+  // stopping at the first ancestor that is still undecided.
+  for (size_t i = search_path.size(); i-- > 1;) {
+    Node* node = search_path[i];
+    if (!node->IsProven() || node->child_index_ < 0) {
+      break;
+    }
+
+    if (!search_path[i - 1]->UpdateProvenValueFromChild(node->child_index_)) {
+      break;
+    }
   }
 }
+
+int MCTSBase::SeedRoot(Node* root, const uint16_t* visit_counts,
+                       uint64_t legal_moves, int action_size, float value,
+                       bool lazy) {
+  std::vector<float> priors(action_size, 0);
+  float total = 0;
+  for (int action = 0; action < action_size; ++action) {
+    if (legal_moves & (uint64_t{1} << action)) {
+      priors[action] = visit_counts[action];
+      total += visit_counts[action];
+    }
+  }
+  if (total == 0) {
+    return -1;
+  }
+  for (auto& prior : priors) {
+    prior /= total;
+  }
+
+  int num_created = root->Expand(root->GetPlayerId(), priors, lazy);
+  // Children see the position from the other side
+  for (int i = 0; i < root->GetNumChildren(); ++i) {
+    int count = visit_counts[root->child_actions_[i]];
+    root->child_visit_counts_[i] = count;
+    root->child_value_sums_[i] = -value * count;
+    if (root->Children[i] != nullptr) {
+      root->Children[i]->visit_count_ = count;
+      root->Children[i]->value_sum_ = -value * count;
+    }
+  }
+  root->visit_count_ = total;
+  root->value_sum_ = value * total;
+  return num_created;
+}
+
+int64_t MCTSBase::PruneTree(Node* root, int64_t num_nodes) {
+  // Every expanded node below the root, with its depth
+  std::vector<std::pair<Node*, int>> expanded;
+  std::vector<std::pair<Node*, int>> stack({{root, 0}});
+  while (!stack.empty()) {
+    auto entry = stack.back();
+    stack.pop_back();
+    for (auto& child : entry.first->Children) {
+      if (child != nullptr && child->IsExpanded()) {
+        expanded.emplace_back(child.get(), entry.second + 1);
+        stack.emplace_back(child.get(), entry.second + 1);
+      }
+    }
+  }
+
+  // A node has more visits than any of its descendants, and deeper nodes go
+  // first on ties, so a subtree is never collapsed before the nodes in it.
+  std::sort(expanded.begin(), expanded.end(),
+            [](const std::pair<Node*, int>& a, const std::pair<Node*, int>& b) {
+              if (a.first->visit_count_ != b.first->visit_count_) {
+                return a.first->visit_count_ < b.first->visit_count_;
+              }
+              return a.second > b.second;
+            });
+
+  int64_t num_deleted = 0;
+  for (auto& entry : expanded) {
+    if (num_deleted >= num_nodes) {
+      break;
+    }
+    num_deleted += entry.first->Collapse();
+  }
+  return num_deleted;
+}
+
+template class BasicMCTS<ConnectXGame>;
+template class BasicMCTS<FixedConnect2Game>;
+template class BasicMCTS<FixedConnect4Game>;
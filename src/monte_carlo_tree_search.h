@@ -1,38 +1,168 @@
 #ifndef MCTS_H
 #define MCTS_H
 
+#include <evaluator.h>
 #include <game.h>
-#include <model.h>
-#include <torch/torch.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <random>
+#include <type_traits>
+
+class OpeningBook;
+class Tablebase;
+
+struct MCTSOptions {
+  // Weight of the prior term in the PUCT score used to select children.
+  float c_puct = 1.0;
+  // Propagate proven wins, losses and draws up the tree, stop visiting solved
+  // subtrees and end the search as soon as the root is solved.
+  bool use_solver = false;
+  // Leaves found in the tablebase take their exact value instead of being
+  // evaluated by the model, just like finished games.
+  const Tablebase* tablebase = nullptr;
+  // Roots found in the book are seeded with its visit counts and value and
+  // returned without searching. Self-play ignores it unless
+  // TrainerOptions::self_play_opening_book is set.
+  const OpeningBook* opening_book = nullptr;
+  // Prune the search tree once it holds this many nodes. Zero means no limit.
+  int64_t max_nodes = 0;
+  // Prune once this many nodes are alive across every search in the process,
+  // so that concurrent games share one budget. Zero means no limit.
+  int64_t max_live_nodes = 0;
+  // Expanding a node only records its children's actions and priors. A child
+  // Node is allocated the first time selection picks it, so the many children
+  // that are never visited cost no allocation.
+  bool lazy_children = false;
+  // Searches with a deadline or a stop flag look at them once every this many
+  // simulations, which keeps clock reads off the per-simulation path. Values
+  // below one count as one.
+  int time_check_interval = 8;
+};
+
+// Counters accumulated over every search an MCTS instance runs.
+struct SearchStats {
+  uint64_t searches = 0;
+  // Simulations actually run
+  uint64_t simulations = 0;
+  // Simulations left unused because the search stopped early
+  uint64_t simulations_saved = 0;
+  // Nodes deleted to stay within the node budget
+  uint64_t nodes_pruned = 0;
+  // Leaves evaluated but left unexpanded because pruning couldn't make room
+  uint64_t expansions_skipped = 0;
+  // Nodes allocated, the roots included
+  uint64_t nodes_created = 0;
+  // The largest single search tree, and the most nodes alive in the process
+  uint64_t peak_tree_nodes = 0;
+  uint64_t peak_live_nodes = 0;
+  // Searches answered from the opening book, which run no simulations
+  uint64_t book_hits = 0;
+
+  SearchStats& operator+=(const SearchStats& other) {
+    searches += other.searches;
+    simulations += other.simulations;
+    simulations_saved += other.simulations_saved;
+    nodes_pruned += other.nodes_pruned;
+    expansions_skipped += other.expansions_skipped;
+    nodes_created += other.nodes_created;
+    peak_tree_nodes = std::max(peak_tree_nodes, other.peak_tree_nodes);
+    peak_live_nodes = std::max(peak_live_nodes, other.peak_live_nodes);
+    book_hits += other.book_hits;
+    return *this;
+  }
+};
+
+// The game-theoretic value of a node once it is known, from the perspective
+// of the player to move at that node.
+enum class ProvenValue : int8_t { kUnknown, kWin, kLoss, kDraw };
 
 class Node {
  public:
   Node(float prior, int toPlay, int action);
+  ~Node();
 
   int GetVisitCount() const { return visit_count_; };
   int GetPlayerId() const { return to_play_; };
   int GetAction() const { return action_; };
-  std::vector<int> GetState() const { return state_; };
+  ProvenValue GetProvenValue() const { return proven_value_; };
+  bool IsProven() const { return proven_value_ != ProvenValue::kUnknown; };
+  void SetProvenValue(ProvenValue value) { proven_value_ = value; };
   void AccumulateValue(float val) { value_sum_ += val; };
   void IncrementVisitCount() { ++visit_count_; };
 
-  void Expand(const std::vector<int>& state, int to_play,
-              const std::vector<float>& action_probs);
+  // Adds a child for every action with a nonzero probability and returns the
+  // number of child Nodes allocated, which is none if lazy.
+  int Expand(int to_play, const std::vector<float>& action_probs,
+             bool lazy = false);
+  // Expands with the softmax of the logits over the legal moves, computed
+  // straight into this node's child arrays. Bit i of legal_moves is action i.
+  int ExpandFromLogits(int to_play, const float* action_logits,
+                       uint64_t legal_moves, bool lazy = false);
   bool IsExpanded();
   float GetValue();
   int SelectAction(float temperature);
-  Node* SelectChild();
+  // Whether the most visited child stays ahead of every other child even if
+  // all of the remaining simulations went to a rival.
+  bool IsBestActionSettled(int remaining_simulations) const;
+  int SelectChildIndex(float c_puct) const;
+  Node* SelectChild(float c_puct) { return GetChild(SelectChildIndex(c_puct)); }
+  int GetNumChildren() const { return child_actions_.size(); }
+  int GetChildAction(int child_index) const {
+    return child_actions_[child_index];
+  }
+  int GetChildVisitCount(int child_index) const {
+    return child_visit_counts_[child_index];
+  }
+  // Whether the child's Node has been allocated yet
+  bool HasChild(int child_index) const {
+    return Children[child_index] != nullptr;
+  }
+  // Returns the child's Node, allocating it first if the node was expanded
+  // lazily and the child has never been selected.
+  Node* GetChild(int child_index);
+  // Updates the statistics this node keeps for one of its children.
+  void RecordChildVisit(int child_index, float val) {
+    ++child_visit_counts_[child_index];
+    child_value_sums_[child_index] += val;
+  };
+  // Called once a child has been proven. Updates this node's proven value
+  // minimax-style and returns whether it became proven as a result.
+  bool UpdateProvenValueFromChild(int child_index);
+  // Deletes this node's subtree but keeps its own statistics, which are also
+  // still held by its parent, so a later simulation expands it again. Returns
+  // the number of nodes deleted.
+  int64_t Collapse();
+  int64_t CountDescendants() const;
+
+  // Nodes alive across every search tree in the process
+  static int64_t GetNumLiveNodes() {
+    return num_live_nodes_.load(std::memory_order_relaxed);
+  }
+  // Memory held by a node, including its entries in its parent's arrays
+  static size_t GetBytesPerNode();
+
+  // Takes the child out of this node's tree to become the root of a new
+  // search, keeping its subtree and statistics. This node's own statistics
+  // are left as they were.
+  std::unique_ptr<Node> ReleaseChildByAction(int action);
+
   Node* GetChildByAction(int action) {
-    for(auto&& pointer : Children) {
-      if (pointer->action_ == action) {
-        return pointer.get();
+    for (size_t i = 0; i < child_actions_.size(); ++i) {
+      if (child_actions_[i] == action) {
+        return GetChild(i);
       }
     }
     throw "No child with that action: " + std::to_string(action);
   }
 
+ // Entries are null for children that haven't been allocated yet
  std::vector<std::unique_ptr<Node>> Children;
  private:
   int visit_count_ = 0;
@@ -40,25 +170,126 @@ class Node {
   int action_ = -1;
   float prior_ = 0;
   float value_sum_ = 0;
-  std::vector<int> state_;
+  ProvenValue proven_value_ = ProvenValue::kUnknown;
+  // Position of this node in its parent's Children, or -1 for a root.
+  int child_index_ = -1;
+  // Statistics of the children laid out contiguously, indexed like Children,
+  // so that selection can score every child in one vectorized pass.
+  std::vector<int> child_actions_;
+  std::vector<float> child_priors_;
+  std::vector<int> child_visit_counts_;
+  std::vector<float> child_value_sums_;
+  // Children proven to be a win for the opponent or a draw are moved past this
+  // point so that selection only ever scores the unsolved ones.
+  int num_unproven_children_ = 0;
   std::default_random_engine generator_;
-  float UcbScore_(Node* parent, Node* child);
+
+  static std::atomic<int64_t> num_live_nodes_;
+
+  void SwapChildren_(int a, int b);
+  // Sizes the other child arrays to match child_actions_ and allocates the
+  // children unless lazy. Returns the number allocated.
+  int FinishExpand_(bool lazy);
+
+  friend class MCTSBase;
 };
 
-class MCTS {
+// The parts of the search that don't depend on the game being played
+class MCTSBase {
  public:
-  MCTS(ConnectXGame& game, Model& model);
-
+  template <typename ValidMoves>
   static std::vector<float> MaskInvalidMovesAndNormalize(
-      std::vector<float>& action_probs, const std::vector<int>& valid_moves);
+      std::vector<float>& action_probs, const ValidMoves& valid_moves);
   static void Backup(const std::vector<Node*>& search_path, float value, int to_play);
+  // Collapses the least visited subtrees below the root until at least
+  // num_nodes nodes are deleted or only the root's children are left. Returns
+  // the number of nodes deleted.
+  static int64_t PruneTree(Node* root, int64_t num_nodes);
+  // Expands an unexpanded root as if a search had given its legal children
+  // these visit counts and the root this value. Returns the number of child
+  // Nodes allocated, or -1 without touching the root if no legal move has a
+  // visit.
+  static int SeedRoot(Node* root, const uint16_t* visit_counts,
+                      uint64_t legal_moves, int action_size, float value,
+                      bool lazy);
+};
+
+// Search over any game that provides the ConnectXGame methods and a Board
+// type. Instantiating it on a FixedConnectXGame lets every game call on the
+// hot path be inlined; BasicMCTS<ConnectXGame> goes through the virtual
+// interface instead.
+template <typename Game>
+class BasicMCTS : public MCTSBase {
+ public:
+  using Board = typename Game::Board;
+  using Clock = std::chrono::steady_clock;
+  static constexpr int kUnlimited = std::numeric_limits<int>::max();
+
+  BasicMCTS(const Game& game, Evaluator& model,
+            MCTSOptions options = MCTSOptions());
 
-  Node* Run(std::vector<int> state, int to_play,
-            int num_simulations);
+  Node* Run(Board state, int to_play, int num_simulations);
+  // Runs at least min_simulations and at most max_simulations, stopping in
+  // between as soon as the move SelectAction would play is settled.
+  Node* Run(Board state, int to_play, int min_simulations,
+            int max_simulations);
+  // Searches until the deadline passes and returns the tree built so far.
+  // The clock is read every time_check_interval simulations, so the search
+  // may overrun the deadline by up to that many simulations.
+  Node* RunUntil(Board state, int to_play, Clock::time_point deadline);
+  // Keeps searching a tree from an earlier search, such as a subtree taken
+  // out with ReleaseChildByAction. state is the root's position, from the
+  // perspective of the root's player. Stops after max_simulations more, at
+  // the deadline or once stop is set, whichever comes first.
+  void Search(Node* root, Board state, int max_simulations,
+              Clock::time_point deadline = Clock::time_point::max(),
+              const std::atomic<bool>* stop = nullptr);
+
+  const SearchStats& GetStats() const { return stats_; }
 
  private:
-  ConnectXGame& game_;
-  Model& model_;
+  const Game& game_;
+  Evaluator& model_;
+  MCTSOptions options_;
+  SearchStats stats_;
+  // Nodes in the tree of the current Run
+  int64_t num_tree_nodes_ = 0;
+  BatchPrediction Predict_(const Board& board);
+  // Seeds the root from the opening book, returning whether it was found
+  bool PlayFromBook_(Node* root, const Board& state);
+  void Search_(Node* root, const Board& state, int min_simulations,
+               int max_simulations, Clock::time_point deadline,
+               const std::atomic<bool>* stop);
+  bool IsOverNodeBudget_() const;
+  // Prunes down to three quarters of whichever budget is exceeded
+  void PruneToNodeBudget_(Node* root);
 };
 
+// The instantiations compiled in monte_carlo_tree_search.cpp
+extern template class BasicMCTS<ConnectXGame>;
+extern template class BasicMCTS<FixedConnect2Game>;
+extern template class BasicMCTS<FixedConnect4Game>;
+
+using MCTS = BasicMCTS<ConnectXGame>;
+
+template <typename ValidMoves>
+std::vector<float> MCTSBase::MaskInvalidMovesAndNormalize(
+    std::vector<float>& action_probs, const ValidMoves& valid_moves) {
+  // Mask out invalid moves
+  std::transform(action_probs.begin(), action_probs.end(), valid_moves.begin(),
+                 action_probs.begin(), std::multiplies<float>());
+
+  // Normalize remaining probabilities
+  float kEps = 1e-9;
+  float sum_of_valid_probs =
+      std::accumulate(action_probs.begin(), action_probs.end(), 0.0) + kEps;
+
+  std::transform(action_probs.begin(), action_probs.end(), action_probs.begin(),
+                 [&sum_of_valid_probs](float prob) -> float {
+                   return prob / sum_of_valid_probs;
+                 });
+
+  return action_probs;
+}
+
 #endif /* MCTS_H */
\ No newline at end of file
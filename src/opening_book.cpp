@@ -0,0 +1,220 @@
+#include "opening_book.h"
+
+#include "game_record.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+const char kOpeningBookMagic[8] = {'A', 'Z', 'B', 'O', 'O', 'K', '\0', '\0'};
+const uint32_t kOpeningBookVersion = 1;
+
+void AddPosition(const std::vector<int>& board,
+                 const std::vector<float>& visit_counts, float value,
+                 BookPositions& positions) {
+  auto& position = positions[HashBoard(board)];
+  position.visit_counts.resize(visit_counts.size());
+  for (size_t action = 0; action < visit_counts.size(); ++action) {
+    position.visit_counts[action] += visit_counts[action];
+  }
+  position.value_sum += value;
+  ++position.num_samples;
+}
+
+void SearchPositions(const ConnectXGame& game, MCTS& mcts,
+                     const std::vector<int>& board, int depth,
+                     int num_simulations, std::unordered_set<uint64_t>& seen,
+                     BookPositions& positions) {
+  if (!seen.insert(HashBoard(board)).second ||
+      game.GetRewardForPlayer(board, /*player=*/1).has_value()) {
+    return;
+  }
+
+  auto valid_moves = game.GetValidMoves(board);
+  auto root = std::unique_ptr<Node>(mcts.Run(board, /*to_play=*/1,
+                                             num_simulations));
+  std::vector<float> visit_counts(valid_moves.size(), 0);
+  for (int i = 0; i < root->GetNumChildren(); ++i) {
+    visit_counts[root->GetChildAction(i)] = root->GetChildVisitCount(i);
+  }
+  float value = root->GetValue();
+  if (root->GetProvenValue() == ProvenValue::kWin ||
+      root->GetProvenValue() == ProvenValue::kDraw) {
+    // The solver stops the search as soon as it proves the root, so its few
+    // visits need not favour the proven move. Book that move alone, as the
+    // trainer does for its targets, with its exact value.
+    std::fill(visit_counts.begin(), visit_counts.end(), 0);
+    visit_counts[root->SelectAction(/*temperature=*/0)] = 1;
+    value = root->GetProvenValue() == ProvenValue::kWin ? 1 : 0;
+  }
+  AddPosition(board, visit_counts, value, positions);
+
+  if (depth == 0) {
+    return;
+  }
+  for (size_t action = 0; action < valid_moves.size(); ++action) {
+    if (valid_moves[action] == 0) {
+      continue;
+    }
+    auto next_board = board;
+    game.PlayMove(next_board, /*player=*/1, action);
+    game.MakeCanonical(next_board, /*player=*/-1);
+    SearchPositions(game, mcts, next_board, depth - 1, num_simulations, seen,
+                    positions);
+  }
+}
+
+}  // namespace
+
+void AddSearchedPositions(const ConnectXGame& game, Evaluator& evaluator,
+                          int max_depth, int num_simulations,
+                          const MCTSOptions& options,
+                          BookPositions& positions) {
+  AddSearchedPositions(game, evaluator, game.GetInitBoard(), max_depth,
+                       num_simulations, options, positions);
+}
+
+void AddSearchedPositions(const ConnectXGame& game, Evaluator& evaluator,
+                          const std::vector<int>& board, int max_depth,
+                          int num_simulations, const MCTSOptions& options,
+                          BookPositions& positions) {
+  // Searching from scratch, not from an earlier version of the book
+  auto search_options = options;
+  search_options.opening_book = nullptr;
+  MCTS mcts(game, evaluator, search_options);
+  std::unordered_set<uint64_t> seen;
+  SearchPositions(game, mcts, board, max_depth, num_simulations, seen,
+                  positions);
+}
+
+void AddRecordedGames(const ConnectXGame& game, const std::string& path,
+                      int max_depth, BookPositions& positions) {
+  GameRecordReader reader(path);
+  GameRecord record;
+  while (reader.Next(record)) {
+    int current_player = 1;
+    auto state = game.GetInitBoard();
+    int num_moves = std::min<int>(record.moves.size(), max_depth + 1);
+    for (int i = 0; i < num_moves; ++i) {
+      const auto& counts = record.visit_counts[i];
+      AddPosition(game.GetCanonicalBoard(state, current_player),
+                  std::vector<float>(counts.begin(), counts.end()),
+                  record.result * current_player, positions);
+
+      auto state_and_player =
+          game.GetNextState(state, current_player, record.moves[i]);
+      state = state_and_player.board;
+      current_player = state_and_player.player;
+    }
+  }
+}
+
+void WriteOpeningBook(const std::string& path, int board_size, int action_size,
+                      const BookPositions& positions) {
+  // Keep the table at most half full so that probes stay short
+  uint64_t num_slots = 1;
+  while (num_slots < 2 * positions.size()) {
+    num_slots *= 2;
+  }
+
+  std::vector<uint64_t> keys(num_slots, 0);
+  std::vector<float> values(num_slots, 0);
+  std::vector<uint16_t> visit_counts(num_slots * action_size, 0);
+  for (auto& entry : positions) {
+    const auto& position = entry.second;
+    if (static_cast<int>(position.visit_counts.size()) != action_size) {
+      throw std::invalid_argument("Book position has the wrong action size");
+    }
+
+    auto slot = entry.first & (num_slots - 1);
+    while (keys[slot] != 0) {
+      slot = (slot + 1) & (num_slots - 1);
+    }
+    keys[slot] = entry.first;
+    values[slot] = position.value_sum / std::max(position.num_samples, 1u);
+    auto counts = QuantizeVisitCounts(position.visit_counts);
+    std::copy(counts.begin(), counts.end(),
+              visit_counts.begin() + slot * action_size);
+  }
+
+  OpeningBookHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kOpeningBookMagic, sizeof(kOpeningBookMagic));
+  header.version = kOpeningBookVersion;
+  header.board_size = board_size;
+  header.action_size = action_size;
+  header.num_entries = positions.size();
+  header.num_slots = num_slots;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(keys.data()),
+            keys.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(values.data()),
+            values.size() * sizeof(float));
+  out.write(reinterpret_cast<const char*>(visit_counts.data()),
+            visit_counts.size() * sizeof(uint16_t));
+  if (!out) {
+    throw std::runtime_error("Could not write opening book " + path);
+  }
+}
+
+OpeningBook::OpeningBook(const std::string& path) : file_(path) {
+  OpeningBookHeader header;
+  if (file_.size() < sizeof(header)) {
+    throw std::runtime_error("Opening book file is truncated: " + path);
+  }
+  std::memcpy(&header, file_.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kOpeningBookMagic,
+                  sizeof(kOpeningBookMagic)) != 0 ||
+      header.version != kOpeningBookVersion) {
+    throw std::runtime_error("Not an opening book file: " + path);
+  }
+
+  // Probing relies on num_slots being a power of two, larger counts than the
+  // file has bytes would overflow the size check, and search masks legal
+  // moves in 64 bits
+  if (header.num_slots == 0 ||
+      (header.num_slots & (header.num_slots - 1)) != 0 ||
+      header.action_size == 0 || header.action_size > 64) {
+    throw std::runtime_error("Corrupt opening book header: " + path);
+  }
+  auto expected_size =
+      sizeof(header) + header.num_slots * sizeof(uint64_t) +
+      header.num_slots * sizeof(float) +
+      header.num_slots * header.action_size * sizeof(uint16_t);
+  if (header.num_slots > file_.size() || file_.size() < expected_size) {
+    throw std::runtime_error("Opening book file is truncated: " + path);
+  }
+
+  board_size_ = header.board_size;
+  action_size_ = header.action_size;
+  num_entries_ = header.num_entries;
+  slot_mask_ = header.num_slots - 1;
+  keys_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(header));
+  values_ = reinterpret_cast<const float*>(keys_ + header.num_slots);
+  visit_counts_ = reinterpret_cast<const uint16_t*>(values_ + header.num_slots);
+}
+
+std::optional<BookEntry> OpeningBook::Lookup(const int* cells,
+                                             size_t num_cells) const {
+  if (num_cells != board_size_ || keys_ == nullptr) {
+    return std::nullopt;
+  }
+
+  auto key = HashBoard(cells, num_cells);
+  for (auto slot = key & slot_mask_; keys_[slot] != 0;
+       slot = (slot + 1) & slot_mask_) {
+    if (keys_[slot] == key) {
+      return BookEntry{visit_counts_ + slot * action_size_, values_[slot]};
+    }
+  }
+
+  return std::nullopt;
+}
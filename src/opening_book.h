@@ -0,0 +1,94 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include "evaluator.h"
+#include "game.h"
+#include "mapped_file.h"
+#include "monte_carlo_tree_search.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// On-disk layout: this header, then num_slots uint64_t board hashes (zero for
+// an empty slot), num_slots float values and num_slots rows of action_size
+// uint16_t visit counts. Slots are found by linear probing from
+// HashBoard(board) modulo num_slots, which is a power of two.
+struct OpeningBookHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t board_size;
+  uint32_t action_size;
+  uint32_t reserved;
+  uint64_t num_entries;
+  uint64_t num_slots;
+};
+
+// A book position being built: the visit counts of every search or game that
+// reached it summed, and the values seen there, from the perspective of the
+// player to move.
+struct BookPosition {
+  std::vector<float> visit_counts;
+  double value_sum = 0;
+  uint32_t num_samples = 0;
+};
+
+// Keyed by HashBoard of the canonical board
+using BookPositions = std::unordered_map<uint64_t, BookPosition>;
+
+// Searches every position within max_depth moves of the initial board and
+// adds the root's visit counts and value. A root the solver has proven won or
+// drawn is booked with a single visit on its proven move instead.
+void AddSearchedPositions(const ConnectXGame& game, Evaluator& evaluator,
+                          int max_depth, int num_simulations,
+                          const MCTSOptions& options,
+                          BookPositions& positions);
+// The same from a canonical board with player 1 to move
+void AddSearchedPositions(const ConnectXGame& game, Evaluator& evaluator,
+                          const std::vector<int>& board, int max_depth,
+                          int num_simulations, const MCTSOptions& options,
+                          BookPositions& positions);
+// Adds the positions within max_depth moves of the start of each game in a
+// file of game records, with their recorded visit counts and the game's
+// result.
+void AddRecordedGames(const ConnectXGame& game, const std::string& path,
+                      int max_depth, BookPositions& positions);
+
+void WriteOpeningBook(const std::string& path, int board_size, int action_size,
+                      const BookPositions& positions);
+
+struct BookEntry {
+  // action_size counts, scaled as by QuantizeVisitCounts
+  const uint16_t* visit_counts;
+  // For the player to move
+  float value;
+};
+
+// Policies and values of early positions, memory-mapped from a file written
+// by WriteOpeningBook. Boards are canonical. Point MCTSOptions::opening_book
+// at one to answer its positions without searching.
+class OpeningBook {
+ public:
+  explicit OpeningBook(const std::string& path);
+
+  std::optional<BookEntry> Lookup(const int* cells, size_t num_cells) const;
+  std::optional<BookEntry> Lookup(const std::vector<int>& board) const {
+    return Lookup(board.data(), board.size());
+  }
+  uint64_t GetNumEntries() const { return num_entries_; }
+  int GetActionSize() const { return action_size_; }
+
+ private:
+  MappedFile file_;
+  uint32_t board_size_ = 0;
+  uint32_t action_size_ = 0;
+  uint64_t num_entries_ = 0;
+  uint64_t slot_mask_ = 0;
+  const uint64_t* keys_ = nullptr;
+  const float* values_ = nullptr;
+  const uint16_t* visit_counts_ = nullptr;
+};
+
+#endif /* OPENING_BOOK_H */
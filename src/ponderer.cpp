@@ -0,0 +1,120 @@
+#include "ponderer.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+double GetPercentile(std::vector<double> values, double fraction) {
+  if (values.empty()) {
+    return 0;
+  }
+  // Nearest rank
+  size_t rank = std::min<size_t>(values.size() - 1, fraction * values.size());
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank];
+}
+
+}  // namespace
+
+void LatencyStats::Record(double latency_seconds, double overrun_seconds) {
+  latencies_.push_back(latency_seconds);
+  overruns_.push_back(std::max(0.0, overrun_seconds));
+}
+
+double LatencyStats::GetLatencyPercentile(double fraction) const {
+  return GetPercentile(latencies_, fraction);
+}
+
+double LatencyStats::GetOverrunPercentile(double fraction) const {
+  return GetPercentile(overruns_, fraction);
+}
+
+void LatencyStats::Print(std::ostream& out) const {
+  std::pair<const char*, double> percentiles[] = {
+      {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"max", 1.0}};
+  for (auto& percentile : percentiles) {
+    out << percentile.first << ":\tlatency "
+        << 1e3 * GetLatencyPercentile(percentile.second) << " ms\toverrun "
+        << 1e3 * GetOverrunPercentile(percentile.second) << " ms"
+        << std::endl;
+  }
+}
+
+Ponderer::Ponderer(const ConnectXGame& game, Evaluator& model,
+                   MCTSOptions options)
+    : game_(game), mcts_(game, model, options) {}
+
+Ponderer::~Ponderer() { StopPondering(); }
+
+int Ponderer::SelectMove(const std::vector<int>& canonical_board,
+                         Clock::time_point deadline) {
+  auto start_time = Clock::now();
+  StopPondering();
+  ++stats_.moves;
+
+  // Find the opponent's reply among the pondered positions
+  std::unique_ptr<Node> root;
+  if (tree_ != nullptr) {
+    for (int i = 0; i < tree_->GetNumChildren(); ++i) {
+      auto action = tree_->GetChildAction(i);
+      auto board = tree_board_;
+      game_.PlayMove(board, /*player=*/1, action);
+      game_.MakeCanonical(board, /*player=*/-1);
+      if (board == canonical_board) {
+        root = tree_->ReleaseChildByAction(action);
+        ++stats_.hits;
+        stats_.reused_visits += root->GetVisitCount();
+        break;
+      }
+    }
+    tree_.reset();
+  }
+  if (root == nullptr) {
+    root = std::make_unique<Node>(0, /*to_play=*/1, -1);
+  }
+
+  mcts_.Search(root.get(), canonical_board, MCTS::kUnlimited, deadline);
+  auto action = root->SelectAction(/*temperature=*/0);
+
+  // Keep the subtree of the move played, unless it ends the game
+  auto board = canonical_board;
+  game_.PlayMove(board, /*player=*/1, action);
+  game_.MakeCanonical(board, /*player=*/-1);
+  if (!game_.GetRewardForPlayer(board, /*player=*/1).has_value()) {
+    tree_ = root->ReleaseChildByAction(action);
+    tree_board_ = std::move(board);
+  }
+  root.reset();
+
+  auto end_time = Clock::now();
+  latency_.Record(
+      std::chrono::duration<double>(end_time - start_time).count(),
+      std::chrono::duration<double>(end_time - deadline).count());
+  return action;
+}
+
+void Ponderer::StartPondering(int max_simulations) {
+  StopPondering();
+  if (tree_ == nullptr) {
+    return;
+  }
+
+  stop_ = false;
+  thread_ = std::thread([this, max_simulations]() {
+    mcts_.Search(tree_.get(), tree_board_, max_simulations,
+                 Clock::time_point::max(), &stop_);
+  });
+}
+
+void Ponderer::StopPondering() {
+  if (thread_.joinable()) {
+    stop_ = true;
+    thread_.join();
+  }
+}
+
+void Ponderer::Reset() {
+  StopPondering();
+  tree_.reset();
+}
@@ -0,0 +1,87 @@
+#ifndef PONDERER_H
+#define PONDERER_H
+
+#include "evaluator.h"
+#include "game.h"
+#include "monte_carlo_tree_search.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Move times measured against the deadline each move was given
+class LatencyStats {
+ public:
+  void Record(double latency_seconds, double overrun_seconds);
+
+  int GetNumMoves() const { return latencies_.size(); }
+  // The time within which the given fraction of moves, e.g. 0.99, returned
+  double GetLatencyPercentile(double fraction) const;
+  // The same for how far moves ran past their deadline, zero if in time
+  double GetOverrunPercentile(double fraction) const;
+  // p50, p90, p99 and max of both, in milliseconds
+  void Print(std::ostream& out) const;
+
+ private:
+  std::vector<double> latencies_;
+  std::vector<double> overruns_;
+};
+
+struct PonderStats {
+  uint64_t moves = 0;
+  // Moves whose position had been searched while pondering
+  uint64_t hits = 0;
+  // Simulations inherited from pondering by the roots of those moves
+  uint64_t reused_visits = 0;
+};
+
+// Plays moves against a clock and keeps thinking on the opponent's time.
+// After each move the subtree under the move played is kept; StartPondering
+// goes on searching it in the background, which spends most of its effort
+// under the replies the search expects. If the opponent then plays one of
+// them, the next SelectMove starts from that reply's subtree.
+class Ponderer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  Ponderer(const ConnectXGame& game, Evaluator& model,
+           MCTSOptions options = MCTSOptions());
+  ~Ponderer();
+
+  Ponderer(const Ponderer&) = delete;
+  Ponderer& operator=(const Ponderer&) = delete;
+
+  // Stops pondering, searches the canonical board until the deadline and
+  // returns the move to play
+  int SelectMove(const std::vector<int>& canonical_board,
+                 Clock::time_point deadline);
+  // Searches the opponent's replies to the last move in the background until
+  // the next SelectMove, StopPondering or max_simulations. Does nothing if
+  // that move ended the game.
+  void StartPondering(int max_simulations = MCTS::kUnlimited);
+  void StopPondering();
+  // Drops the kept tree, e.g. before a new game
+  void Reset();
+
+  const PonderStats& GetStats() const { return stats_; }
+  const LatencyStats& GetLatency() const { return latency_; }
+  // Only safe to call while not pondering
+  const SearchStats& GetSearchStats() const { return mcts_.GetStats(); }
+
+ private:
+  const ConnectXGame& game_;
+  MCTS mcts_;
+  // The subtree after our last move, with the opponent to move, and its
+  // position from the opponent's perspective
+  std::unique_ptr<Node> tree_;
+  std::vector<int> tree_board_;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  PonderStats stats_;
+  LatencyStats latency_;
+};
+
+#endif /* PONDERER_H */
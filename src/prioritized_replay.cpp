@@ -0,0 +1,81 @@
+#include "prioritized_replay.h"
+
+#include <algorithm>
+#include <cmath>
+
+SumTree::SumTree(size_t size) : size_(size), capacity_(1) {
+  while (capacity_ < size_) {
+    capacity_ *= 2;
+  }
+  nodes_.assign(2 * capacity_, 0);
+}
+
+void SumTree::Set(size_t index, double priority) {
+  size_t node = capacity_ + index;
+  double change = priority - nodes_[node];
+  for (; node >= 1; node /= 2) {
+    nodes_[node] += change;
+  }
+}
+
+size_t SumTree::Find(double value) const {
+  size_t node = 1;
+  while (node < capacity_) {
+    double left = nodes_[2 * node];
+    if (value < left || nodes_[2 * node + 1] <= 0) {
+      node = 2 * node;
+    } else {
+      value -= left;
+      node = 2 * node + 1;
+    }
+  }
+  // Rounding can carry a value just past the last non-empty leaf
+  return std::min(node - capacity_, size_ - 1);
+}
+
+PrioritizedReplay::PrioritizedReplay(size_t num_examples,
+                                     PrioritizedReplayOptions options)
+    : options_(options), tree_(num_examples) {
+  // Every example starts equally likely, until its first loss is known
+  for (size_t i = 0; i < num_examples; ++i) {
+    tree_.Set(i, 1);
+  }
+}
+
+std::vector<size_t> PrioritizedReplay::Sample(size_t batch_size,
+                                              std::mt19937& generator) const {
+  std::vector<size_t> indices(batch_size);
+  double slice = tree_.GetTotal() / batch_size;
+  std::uniform_real_distribution<double> distr(0, slice);
+  for (size_t i = 0; i < batch_size; ++i) {
+    indices[i] = tree_.Find(i * slice + distr(generator));
+  }
+  return indices;
+}
+
+std::vector<float> PrioritizedReplay::GetImportanceWeights(
+    const std::vector<size_t>& indices) const {
+  std::vector<float> weights(indices.size());
+  if (weights.empty()) {
+    return weights;
+  }
+  double num_examples = tree_.GetSize();
+  for (size_t i = 0; i < indices.size(); ++i) {
+    double probability = tree_.Get(indices[i]) / tree_.GetTotal();
+    weights[i] = std::pow(num_examples * probability, -options_.beta);
+  }
+
+  float max_weight = *std::max_element(weights.begin(), weights.end());
+  for (auto& weight : weights) {
+    weight /= max_weight;
+  }
+  return weights;
+}
+
+void PrioritizedReplay::Update(const std::vector<size_t>& indices,
+                               const std::vector<float>& losses) {
+  for (size_t i = 0; i < indices.size(); ++i) {
+    tree_.Set(indices[i],
+              std::pow(losses[i] + options_.epsilon, options_.alpha));
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef PRIORITIZED_REPLAY_H
+#define PRIORITIZED_REPLAY_H
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Complete binary tree whose leaves hold non-negative priorities and whose
+// inner nodes hold the sum of their children, so that changing a priority
+// and drawing an index in proportion to its priority are both O(log n).
+class SumTree {
+ public:
+  explicit SumTree(size_t size);
+
+  size_t GetSize() const { return size_; }
+  double GetTotal() const { return nodes_[1]; }
+  double Get(size_t index) const { return nodes_[capacity_ + index]; }
+  void Set(size_t index, double priority);
+  // The index whose share of [0, GetTotal()) contains value, counting the
+  // leaves from the left
+  size_t Find(double value) const;
+
+ private:
+  size_t size_;
+  // Leaves start here; a power of two
+  size_t capacity_;
+  // 1-based heap layout, the root at 1
+  std::vector<double> nodes_;
+};
+
+struct PrioritizedReplayOptions {
+  // Sample training examples in proportion to their last loss instead of
+  // walking them in a shuffled order.
+  bool enabled = false;
+  // How strongly the loss shapes the sampling; 0 is uniform
+  float alpha = 0.6;
+  // How much of the sampling bias the importance weights undo; 1 is all of it
+  float beta = 0.4;
+  // Added to every loss so that no example stops being sampled altogether
+  float epsilon = 0.01;
+};
+
+// Draws batches of example indices from a sum tree over the replay buffer,
+// with the importance-sampling weights that keep the loss an unbiased
+// estimate of the loss over the whole buffer.
+class PrioritizedReplay {
+ public:
+  PrioritizedReplay(size_t num_examples, PrioritizedReplayOptions options);
+
+  // Draws batch_size indices with replacement, stratified so that each falls
+  // in its own equal slice of the total priority
+  std::vector<size_t> Sample(size_t batch_size, std::mt19937& generator) const;
+  // (N * P(i))^-beta, scaled so the largest weight in the batch is 1
+  std::vector<float> GetImportanceWeights(
+      const std::vector<size_t>& indices) const;
+  // Sets the priorities of the sampled examples from their new losses
+  void Update(const std::vector<size_t>& indices,
+              const std::vector<float>& losses);
+
+ private:
+  PrioritizedReplayOptions options_;
+  SumTree tree_;
+};
+
+#endif /* PRIORITIZED_REPLAY_H */
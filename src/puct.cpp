@@ -0,0 +1,104 @@
+#include "puct.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline float PuctScore(float prior, int visit_count, float value_sum,
+                       float exploration) {
+  float prior_score = prior * exploration / (visit_count + 1);
+  float value_score = value_sum / std::max(visit_count, 1);
+  return prior_score - value_score;
+}
+
+}  // namespace
+
+int SelectPuctIndexScalar(const float* priors, const int* visit_counts,
+                          const float* value_sums, int num_children,
+                          float c_puct, float sqrt_parent_visits) {
+  const float exploration = c_puct * sqrt_parent_visits;
+  float best_score = -std::numeric_limits<float>::max();
+  int best_index = 0;
+
+  for (int i = 0; i < num_children; ++i) {
+    auto score =
+        PuctScore(priors[i], visit_counts[i], value_sums[i], exploration);
+    if (score > best_score) {
+      best_score = score;
+      best_index = i;
+    }
+  }
+
+  return best_index;
+}
+
+int SelectPuctIndex(const float* priors, const int* visit_counts,
+                    const float* value_sums, int num_children, float c_puct,
+                    float sqrt_parent_visits) {
+#if defined(__SSE2__)
+  const float exploration = c_puct * sqrt_parent_visits;
+  const __m128 exploration4 = _mm_set1_ps(exploration);
+  const __m128 one4 = _mm_set1_ps(1.0f);
+  const __m128i step4 = _mm_set1_epi32(4);
+
+  // Each lane keeps its own running maximum and the index it came from.
+  __m128 best4 = _mm_set1_ps(-std::numeric_limits<float>::max());
+  __m128i best_index4 = _mm_setzero_si128();
+  __m128i index4 = _mm_setr_epi32(0, 1, 2, 3);
+
+  int i = 0;
+  for (; i + 4 <= num_children; i += 4) {
+    __m128 visits = _mm_cvtepi32_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(visit_counts + i)));
+    __m128 prior_score =
+        _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(priors + i), exploration4),
+                   _mm_add_ps(visits, one4));
+    __m128 value_score =
+        _mm_div_ps(_mm_loadu_ps(value_sums + i), _mm_max_ps(visits, one4));
+    __m128 score = _mm_sub_ps(prior_score, value_score);
+
+    __m128 better = _mm_cmpgt_ps(score, best4);
+    __m128i better_i = _mm_castps_si128(better);
+    best4 = _mm_or_ps(_mm_and_ps(better, score), _mm_andnot_ps(better, best4));
+    best_index4 = _mm_or_si128(_mm_and_si128(better_i, index4),
+                               _mm_andnot_si128(better_i, best_index4));
+    index4 = _mm_add_epi32(index4, step4);
+  }
+
+  alignas(16) float lane_scores[4];
+  alignas(16) int lane_indices[4];
+  _mm_store_ps(lane_scores, best4);
+  _mm_store_si128(reinterpret_cast<__m128i*>(lane_indices), best_index4);
+
+  // Reduce across lanes, breaking ties towards the lower index so the result
+  // matches the scalar loop exactly.
+  float best_score = lane_scores[0];
+  int best_index = lane_indices[0];
+  for (int lane = 1; lane < 4; ++lane) {
+    if (lane_scores[lane] > best_score ||
+        (lane_scores[lane] == best_score && lane_indices[lane] < best_index)) {
+      best_score = lane_scores[lane];
+      best_index = lane_indices[lane];
+    }
+  }
+
+  for (; i < num_children; ++i) {
+    auto score =
+        PuctScore(priors[i], visit_counts[i], value_sums[i], exploration);
+    if (score > best_score) {
+      best_score = score;
+      best_index = i;
+    }
+  }
+
+  return best_index;
+#else
+  return SelectPuctIndexScalar(priors, visit_counts, value_sums, num_children,
+                               c_puct, sqrt_parent_visits);
+#endif
+}
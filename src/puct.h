@@ -0,0 +1,21 @@
+#ifndef PUCT_H
+#define PUCT_H
+
+// Returns the index of the child with the highest PUCT score
+//
+//   c_puct * prior * sqrt(N) / (n + 1) - value_sum / max(n, 1)
+//
+// where N is the parent's visit count and n, value_sum are the child's
+// statistics. Child values are stored from the child's (opposing) point of
+// view, hence the subtraction. Ties go to the lowest index.
+int SelectPuctIndex(const float* priors, const int* visit_counts,
+                    const float* value_sums, int num_children, float c_puct,
+                    float sqrt_parent_visits);
+
+// Plain loop over the children with the same arithmetic as SelectPuctIndex.
+// Kept as the reference implementation and for benchmarking.
+int SelectPuctIndexScalar(const float* priors, const int* visit_counts,
+                          const float* value_sums, int num_children,
+                          float c_puct, float sqrt_parent_visits);
+
+#endif /* PUCT_H */
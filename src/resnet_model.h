@@ -0,0 +1,236 @@
+#ifndef RESNET_MODEL_H
+#define RESNET_MODEL_H
+
+#include <model.h>
+#include <torch/torch.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct ResNetOptions {
+  int rows;
+  int columns;
+  int action_size;
+  int channels = 64;
+  int num_blocks = 5;
+};
+
+// A 3x3 convolution (without bias) followed by batch norm, which can be folded
+// into a single convolution with bias for inference.
+struct ConvBNImpl : torch::nn::Module {
+  ConvBNImpl(int in_channels, int out_channels, int kernel_size)
+      : padding(kernel_size / 2),
+        conv(register_module(
+            "conv", torch::nn::Conv2d(
+                        torch::nn::Conv2dOptions(in_channels, out_channels,
+                                                 kernel_size)
+                            .padding(kernel_size / 2)
+                            .bias(false)))),
+        bn(register_module("bn", torch::nn::BatchNorm2d(out_channels))) {}
+
+  torch::Tensor forward(const torch::Tensor& x) { return bn(conv(x)); }
+
+  // Scales the convolution weights by the batch norm's running statistics
+  // so that forward_folded(x) == forward(x) in eval mode.
+  void Fold() {
+    torch::NoGradGuard guard;
+    auto scale = bn->weight / torch::sqrt(bn->running_var + bn->options.eps());
+    folded_weight = (conv->weight * scale.view({-1, 1, 1, 1}))
+                        .contiguous(torch::MemoryFormat::ChannelsLast);
+    folded_bias = bn->bias - bn->running_mean * scale;
+  }
+
+  torch::Tensor forward_folded(const torch::Tensor& x) {
+    return torch::conv2d(x, folded_weight, folded_bias, /*stride=*/{1, 1},
+                         /*padding=*/{padding, padding});
+  }
+
+  int64_t padding;
+  torch::nn::Conv2d conv;
+  torch::nn::BatchNorm2d bn;
+  torch::Tensor folded_weight;
+  torch::Tensor folded_bias;
+};
+TORCH_MODULE(ConvBN);
+
+struct ResidualBlockImpl : torch::nn::Module {
+  explicit ResidualBlockImpl(int channels)
+      : conv1(register_module("conv1", ConvBN(channels, channels, 3))),
+        conv2(register_module("conv2", ConvBN(channels, channels, 3))) {}
+
+  torch::Tensor forward(const torch::Tensor& x) {
+    auto out = torch::relu(conv1(x));
+    return torch::relu(conv2(out) + x);
+  }
+
+  torch::Tensor forward_folded(const torch::Tensor& x) {
+    auto out = torch::relu(conv1->forward_folded(x));
+    return torch::relu(conv2->forward_folded(out) + x);
+  }
+
+  ConvBN conv1;
+  ConvBN conv2;
+};
+TORCH_MODULE(ResidualBlock);
+
+// AlphaZero-style residual network for ConnectX boards of any size.
+//
+// Boards arrive flattened, as for Connect2Model, and are encoded as two planes
+// (the player to move's pieces and the opponent's) in channels-last layout. A
+// 3x3 stem feeds num_blocks residual blocks, followed by separate policy and
+// value heads. predict() runs with every batch norm folded into the preceding
+// convolution; the folded weights are recomputed whenever a parameter or
+// buffer has changed since they were last computed, however it changed.
+struct ResNetModel : torch::nn::Module, Model {
+  ResNetModel(ResNetOptions options, torch::Device device)
+      : Model(options.rows * options.columns, options.action_size),
+        options(options),
+        device(device),
+        stem(register_module("stem", ConvBN(2, options.channels, 3))),
+        policy_conv(
+            register_module("policy_conv", ConvBN(options.channels, 2, 1))),
+        policy_fc(register_module(
+            "policy_fc", torch::nn::Linear(2 * board_size, action_size))),
+        value_conv(
+            register_module("value_conv", ConvBN(options.channels, 1, 1))),
+        value_fc1(
+            register_module("value_fc1", torch::nn::Linear(board_size, 64))),
+        value_fc2(register_module("value_fc2", torch::nn::Linear(64, 1))) {
+    for (int i = 0; i < options.num_blocks; ++i) {
+      blocks.push_back(register_module("block" + std::to_string(i),
+                                       ResidualBlock(options.channels)));
+    }
+    this->to(device);
+  }
+
+  ActionProbsAndValueTensor forward(const torch::Tensor& input) override {
+    auto x = torch::relu(stem(EncodePlanes(input)));
+    for (auto& block : blocks) {
+      x = block(x);
+    }
+    auto result =
+        HeadLogits(torch::relu(policy_conv(x)), torch::relu(value_conv(x)));
+    return {torch::softmax(result.action_logits, 1), result.value};
+  }
+
+  // Eval-mode forward pass using the folded convolutions. The module's own
+  // training mode is left as it is.
+  ActionProbsAndValueTensor forward_inference(const torch::Tensor& input) {
+    auto result = forward_inference_logits(input);
+    return {torch::softmax(result.action_logits, 1), result.value};
+  }
+
+  ActionLogitsAndValueTensor forward_inference_logits(
+      const torch::Tensor& input) {
+    if (!folded_signature.has_value() ||
+        *folded_signature != GetWeightsSignature()) {
+      FoldBatchNorm();
+    }
+
+    torch::NoGradGuard guard;
+    auto x = torch::relu(stem->forward_folded(EncodePlanes(input)));
+    for (auto& block : blocks) {
+      x = block->forward_folded(x);
+    }
+    return HeadLogits(torch::relu(policy_conv->forward_folded(x)),
+                      torch::relu(value_conv->forward_folded(x)));
+  }
+
+  ActionProbsAndValue predict(std::vector<int>& board) override {
+    auto opts = torch::TensorOptions().dtype(torch::kInt32);
+    auto input =
+        torch::from_blob(board.data(), board.size(), opts).to(torch::kFloat32);
+    input = input.view({1, board_size}).to(this->device);
+
+    ActionProbsAndValueTensor result = this->forward_inference(input);
+
+    // Unpack values from tensors into primitive types
+    auto action_probs_tensor = result.action_probs.cpu();
+    auto value = result.value.cpu().item<float>();
+    std::vector<float> action_probs(
+        action_probs_tensor.data_ptr<float>(),
+        action_probs_tensor.data_ptr<float>() + action_probs_tensor.numel());
+
+    return {action_probs, value};
+  }
+
+  ActionLogitsAndValue predict_logits(std::vector<int>& board) override {
+    auto result = predict_batch(board.data(), 1);
+    return {std::vector<float>(result.action_logits,
+                               result.action_logits + action_size),
+            result.values[0]};
+  }
+
+  BatchPrediction predict_batch(const int* boards, int batch_size) override {
+    auto& buffers = torch_batch_buffers_.Get();
+    auto input = buffers.FillInput(boards, batch_size, board_size, device);
+    return buffers.StoreOutput(this->forward_inference_logits(input),
+                               batch_size, action_size);
+  }
+
+  void FoldBatchNorm() {
+    stem->Fold();
+    for (auto& block : blocks) {
+      block->conv1->Fold();
+      block->conv2->Fold();
+    }
+    policy_conv->Fold();
+    value_conv->Fold();
+    folded_signature = GetWeightsSignature();
+  }
+
+  // Changes whenever a parameter or buffer is modified in place or replaced:
+  // optimizer steps, batch norm statistics updated by a training forward,
+  // loading a checkpoint and WeightSubscriber refreshes alike
+  uint64_t GetWeightsSignature() {
+    uint64_t signature = 14695981039346656037ULL;
+    auto mix = [&signature](const torch::Tensor& tensor) {
+      signature = (signature ^ static_cast<uint64_t>(tensor._version())) *
+                  1099511628211ULL;
+      signature = (signature ^ reinterpret_cast<uintptr_t>(tensor.data_ptr())) *
+                  1099511628211ULL;
+    };
+    for (const auto& parameter : parameters()) {
+      mix(parameter);
+    }
+    for (const auto& buffer : buffers()) {
+      mix(buffer);
+    }
+    return signature;
+  }
+
+  ResNetOptions options;
+  torch::Device device;
+  // GetWeightsSignature() when the batch norms were last folded
+  std::optional<uint64_t> folded_signature;
+
+  ConvBN stem;
+  std::vector<ResidualBlock> blocks;
+  ConvBN policy_conv;
+  torch::nn::Linear policy_fc;
+  ConvBN value_conv;
+  torch::nn::Linear value_fc1;
+  torch::nn::Linear value_fc2;
+
+ private:
+  // [batch, rows * columns] boards of +1/-1/0 to [batch, 2, rows, columns]
+  torch::Tensor EncodePlanes(const torch::Tensor& input) {
+    auto boards = input.view({-1, 1, options.rows, options.columns});
+    auto planes = torch::cat({boards.eq(1), boards.eq(-1)}, 1);
+    return planes.to(torch::kFloat32)
+        .contiguous(torch::MemoryFormat::ChannelsLast);
+  }
+
+  ActionLogitsAndValueTensor HeadLogits(const torch::Tensor& policy,
+                                        const torch::Tensor& value) {
+    auto action_logits = policy_fc(policy.flatten(1));
+    auto value_hidden = torch::relu(value_fc1(value.flatten(1)));
+
+    auto value_out = torch::tanh(value_fc2(value_hidden));
+
+    return {action_logits, value_out};
+  }
+};
+
+#endif /* RESNET_MODEL_H */
@@ -0,0 +1,284 @@
+#include "rollout_evaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline bool HasLine(uint64_t stones, const BitboardLayout& layout) {
+  const int shifts[4] = {1, layout.height, layout.height - 1,
+                         layout.height + 1};
+  for (int shift : shifts) {
+    uint64_t line = stones;
+    for (int i = 1; i < layout.num_to_win; ++i) {
+      line &= stones >> (i * shift);
+    }
+    if (line != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+BitboardLayout::BitboardLayout(int rows, int columns, int num_to_win)
+    : rows(rows),
+      columns(columns),
+      num_to_win(num_to_win),
+      height(rows + 1),
+      bottom_row(0),
+      top_row(0) {
+  if (height * columns > 64) {
+    throw std::invalid_argument("The board doesn't fit a 64-bit bitboard");
+  }
+  for (int column = 0; column < columns; ++column) {
+    bottom_row |= uint64_t(1) << (column * height);
+    top_row |= uint64_t(1) << (column * height + rows - 1);
+  }
+}
+
+uint64_t BitboardLayout::ToBitboard(const int* board, int player) const {
+  uint64_t stones = 0;
+  for (int row = 0; row < rows; ++row) {
+    for (int column = 0; column < columns; ++column) {
+      if (board[row * columns + column] == player) {
+        // Row 0 of the board is the top
+        stones |= uint64_t(1) << (column * height + rows - 1 - row);
+      }
+    }
+  }
+  return stones;
+}
+
+uint32_t FindLinesScalar(const uint64_t* stones, int num_boards,
+                         const BitboardLayout& layout) {
+  uint32_t lines = 0;
+  for (int i = 0; i < num_boards; ++i) {
+    lines |= uint32_t(HasLine(stones[i], layout)) << i;
+  }
+  return lines;
+}
+
+uint32_t FindLines(const uint64_t* stones, int num_boards,
+                   const BitboardLayout& layout) {
+#if defined(__SSE2__)
+  const int shifts[4] = {1, layout.height, layout.height - 1,
+                         layout.height + 1};
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t lines = 0;
+
+  int i = 0;
+  for (; i + 2 <= num_boards; i += 2) {
+    __m128i boards =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(stones + i));
+    __m128i any_line = zero;
+    for (int shift : shifts) {
+      __m128i line = boards;
+      for (int j = 1; j < layout.num_to_win; ++j) {
+        line = _mm_and_si128(
+            line, _mm_srl_epi64(boards, _mm_cvtsi32_si128(j * shift)));
+      }
+      any_line = _mm_or_si128(any_line, line);
+    }
+
+    // A board has no line when both 32-bit halves of its lane are zero
+    int zero_halves = _mm_movemask_ps(
+        _mm_castsi128_ps(_mm_cmpeq_epi32(any_line, zero)));
+    lines |= uint32_t((zero_halves & 0x3) != 0x3) << i;
+    lines |= uint32_t((zero_halves & 0xc) != 0xc) << (i + 1);
+  }
+
+  for (; i < num_boards; ++i) {
+    lines |= uint32_t(HasLine(stones[i], layout)) << i;
+  }
+  return lines;
+#else
+  return FindLinesScalar(stones, num_boards, layout);
+#endif
+}
+
+RolloutEvaluator::RolloutEvaluator(int rows, int columns, int num_to_win,
+                                   RolloutOptions options)
+    : Evaluator(rows * columns, columns),
+      layout_(rows, columns, num_to_win),
+      options_(options),
+      random_state_(options.seed) {}
+
+uint64_t RolloutEvaluator::NextRandom_() {
+  // splitmix64
+  uint64_t z = (random_state_ += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void RolloutEvaluator::Evaluate_(const int* boards, int num_boards,
+                                 float* action_logits, float* values) {
+  auto& buffers = buffers_.Get();
+  std::fill(action_logits,
+            action_logits + static_cast<size_t>(num_boards) * action_size,
+            0.0f);
+
+  // Stones of the player to move and of the opponent on each board that
+  // isn't finished yet, as only those are played out
+  auto& leaves = buffers.leaves;
+  auto& leaf_own = buffers.leaf_own;
+  auto& leaf_opponent = buffers.leaf_opponent;
+  leaves.clear();
+  leaf_own.clear();
+  leaf_opponent.clear();
+  for (int i = 0; i < num_boards; ++i) {
+    const int* board = boards + static_cast<size_t>(i) * board_size;
+    uint64_t own = layout_.ToBitboard(board, 1);
+    uint64_t opponent = layout_.ToBitboard(board, -1);
+    if (HasLine(own, layout_) || HasLine(opponent, layout_)) {
+      values[i] = HasLine(own, layout_) ? 1 : -1;
+      continue;
+    }
+    leaves.push_back(i);
+    leaf_own.push_back(own);
+    leaf_opponent.push_back(opponent);
+  }
+  const int num_leaves = leaves.size();
+  auto& value_sums = buffers.value_sums;
+  auto& first_move_sums = buffers.first_move_sums;
+  auto& first_move_counts = buffers.first_move_counts;
+  value_sums.assign(num_leaves, 0);
+  first_move_sums.assign(static_cast<size_t>(num_leaves) * action_size, 0);
+  first_move_counts.assign(static_cast<size_t>(num_leaves) * action_size, 0);
+
+  // Playout k starts from leaf k % num_leaves, so the lanes played together
+  // come from different leaves whenever the batch has several
+  const int num_rollouts = std::max(options_.num_rollouts, 1);
+  const int64_t total_rollouts = int64_t{num_leaves} * num_rollouts;
+  for (int64_t first = 0; first < total_rollouts; first += kRolloutLanes) {
+    const int num_lanes =
+        std::min<int64_t>(kRolloutLanes, total_rollouts - first);
+    // Each lane is one playout. to_move holds the stones of the player about
+    // to move, so the roles swap after every ply.
+    uint64_t to_move[kRolloutLanes];
+    uint64_t occupied[kRolloutLanes];
+    uint64_t movers[kRolloutLanes];
+    int lane_leaves[kRolloutLanes];
+    int first_moves[kRolloutLanes];
+    float results[kRolloutLanes];
+    for (int lane = 0; lane < num_lanes; ++lane) {
+      int leaf = (first + lane) % num_leaves;
+      lane_leaves[lane] = leaf;
+      to_move[lane] = leaf_own[leaf];
+      occupied[lane] = leaf_own[leaf] | leaf_opponent[leaf];
+      results[lane] = 0;
+    }
+    uint32_t active = (uint32_t(1) << num_lanes) - 1;
+
+    for (int ply = 0; active != 0; ++ply) {
+      for (int lane = 0; lane < num_lanes; ++lane) {
+        movers[lane] = 0;
+        if ((active >> lane & 1) == 0) {
+          continue;
+        }
+        uint64_t legal = ~occupied[lane] & layout_.top_row;
+        if (legal == 0) {
+          // A full board is a draw
+          active &= ~(uint32_t(1) << lane);
+          continue;
+        }
+
+        // Clear a uniformly random number of the legal columns' bits below
+        // the one to play
+        auto skip = (NextRandom_() >> 32) * __builtin_popcountll(legal) >> 32;
+        for (; skip > 0; --skip) {
+          legal &= legal - 1;
+        }
+        int column = __builtin_ctzll(legal) / layout_.height;
+        uint64_t move = (occupied[lane] + layout_.bottom_row) &
+                        layout_.GetColumnMask(column);
+        if (ply == 0) {
+          first_moves[lane] = column;
+        }
+
+        movers[lane] = to_move[lane] | move;
+        occupied[lane] |= move;
+        to_move[lane] = movers[lane] ^ occupied[lane];
+      }
+
+      uint32_t wins = FindLines(movers, num_lanes, layout_) & active;
+      for (int lane = 0; lane < num_lanes; ++lane) {
+        if (wins >> lane & 1) {
+          // Even plies are played by the player to move on the board
+          results[lane] = ply % 2 == 0 ? 1 : -1;
+        }
+      }
+      active &= ~wins;
+    }
+
+    for (int lane = 0; lane < num_lanes; ++lane) {
+      int leaf = lane_leaves[lane];
+      value_sums[leaf] += results[lane];
+      auto move_index =
+          static_cast<size_t>(leaf) * action_size + first_moves[lane];
+      first_move_sums[move_index] += results[lane];
+      ++first_move_counts[move_index];
+    }
+  }
+  num_rollouts_ += total_rollouts;
+
+  for (int leaf = 0; leaf < num_leaves; ++leaf) {
+    int i = leaves[leaf];
+    values[i] = value_sums[leaf] / num_rollouts;
+    if (options_.first_move_prior_scale == 0) {
+      continue;
+    }
+    float* logits = action_logits + static_cast<size_t>(i) * action_size;
+    const float* sums =
+        first_move_sums.data() + static_cast<size_t>(leaf) * action_size;
+    const int* counts =
+        first_move_counts.data() + static_cast<size_t>(leaf) * action_size;
+    for (int action = 0; action < action_size; ++action) {
+      if (counts[action] > 0) {
+        logits[action] =
+            options_.first_move_prior_scale * sums[action] / counts[action];
+      }
+    }
+  }
+}
+
+ActionProbsAndValue RolloutEvaluator::predict(std::vector<int>& board) {
+  auto result = predict_logits(board);
+  auto& probs = result.action_logits;
+  float max_logit = *std::max_element(probs.begin(), probs.end());
+  float sum = 0;
+  for (auto& prob : probs) {
+    prob = std::exp(prob - max_logit);
+    sum += prob;
+  }
+  for (auto& prob : probs) {
+    prob /= sum;
+  }
+  return {std::move(probs), result.value};
+}
+
+ActionLogitsAndValue RolloutEvaluator::predict_logits(std::vector<int>& board) {
+  ActionLogitsAndValue result{std::vector<float>(action_size), 0};
+  Evaluate_(board.data(), /*num_boards=*/1, result.action_logits.data(),
+            &result.value);
+  return result;
+}
+
+BatchPrediction RolloutEvaluator::predict_batch(const int* boards,
+                                                int batch_size) {
+  auto& buffers = buffers_.Get();
+  auto& action_logits = buffers.action_logits;
+  auto& values = buffers.values;
+  action_logits.resize(static_cast<size_t>(batch_size) * action_size);
+  values.resize(batch_size);
+
+  Evaluate_(boards, batch_size, action_logits.data(), values.data());
+  return {action_logits.data(), values.data(), batch_size, action_size};
+}
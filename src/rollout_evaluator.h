@@ -0,0 +1,98 @@
+#ifndef ROLLOUT_EVALUATOR_H
+#define ROLLOUT_EVALUATOR_H
+
+#include "evaluator.h"
+
+#include <cstdint>
+#include <vector>
+
+// Column-major bitboards of a ConnectX board: the cell in column c, row r
+// counted from the bottom, is bit c * height + r with height = rows + 1. The
+// spare bit on top of each column is always clear, so shifting a line of
+// stones never carries it into the next column.
+struct BitboardLayout {
+  BitboardLayout(int rows, int columns, int num_to_win);
+
+  // Stones of the given player on a board laid out as in FixedConnectXGame
+  uint64_t ToBitboard(const int* board, int player) const;
+  uint64_t GetColumnMask(int column) const {
+    return ((uint64_t(1) << height) - 1) << (column * height);
+  }
+
+  int rows;
+  int columns;
+  int num_to_win;
+  int height;
+  // The bottom cell of every column
+  uint64_t bottom_row;
+  // The topmost playable cell of every column
+  uint64_t top_row;
+};
+
+// Sets bit i of the result when stones[i] holds num_to_win in a row, for up to
+// 32 boards. Two boards are checked at once with SSE2.
+uint32_t FindLines(const uint64_t* stones, int num_boards,
+                   const BitboardLayout& layout);
+// Same as FindLines, one board at a time. Kept as the reference
+// implementation.
+uint32_t FindLinesScalar(const uint64_t* stones, int num_boards,
+                         const BitboardLayout& layout);
+
+struct RolloutOptions {
+  // Random playouts averaged into each board's value
+  int num_rollouts = 64;
+  // The logit of each move is this times the mean result of the playouts that
+  // started with it. Zero gives a uniform prior.
+  float first_move_prior_scale = 0;
+  uint64_t seed = 1;
+};
+
+// Network-free evaluator for pure MCTS: a board's value is the mean result of
+// random playouts from it, played on bitboards kRolloutLanes at a time. A
+// batch's playouts share the lanes, so that each group of lanes mixes leaves. Useful
+// as a baseline opponent, to generate examples before the network is any
+// good, and to time the search without inference. Not thread-safe; give each
+// thread its own.
+class RolloutEvaluator : public Evaluator {
+ public:
+  static constexpr int kRolloutLanes = 8;
+
+  RolloutEvaluator(int rows, int columns, int num_to_win,
+                   RolloutOptions options = RolloutOptions());
+
+  ActionProbsAndValue predict(std::vector<int>& board) override;
+  ActionLogitsAndValue predict_logits(std::vector<int>& board) override;
+  BatchPrediction predict_batch(const int* boards, int batch_size) override;
+
+  // Playouts run since construction
+  uint64_t GetNumRollouts() const { return num_rollouts_; }
+
+ private:
+  BitboardLayout layout_;
+  RolloutOptions options_;
+  uint64_t random_state_;
+  uint64_t num_rollouts_ = 0;
+
+  struct RolloutBuffers {
+    // The outputs of predict_batch
+    std::vector<float> action_logits;
+    std::vector<float> values;
+    // Evaluate_'s boards still to play out, and their playouts' results
+    std::vector<int> leaves;
+    std::vector<uint64_t> leaf_own;
+    std::vector<uint64_t> leaf_opponent;
+    std::vector<float> value_sums;
+    std::vector<float> first_move_sums;
+    std::vector<int> first_move_counts;
+  };
+  ThreadBuffers<RolloutBuffers> buffers_;
+
+  uint64_t NextRandom_();
+  // Plays options_.num_rollouts playouts from each of num_boards canonical
+  // boards, writing the values and logits of the player to move. The
+  // playouts of all the boards are interleaved across the lanes.
+  void Evaluate_(const int* boards, int num_boards, float* action_logits,
+                 float* values);
+};
+
+#endif /* ROLLOUT_EVALUATOR_H */
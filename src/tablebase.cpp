@@ -0,0 +1,190 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+const char kTablebaseMagic[8] = {'A', 'Z', 'T', 'B', 'A', 'S', 'E', '\0'};
+const uint32_t kTablebaseVersion = 2;
+
+// Fills the cells listed in stack order with as many pieces of the player to
+// move as own_left and of the opponent as opponent_left, in every order.
+void AssignPieces(std::vector<int>& board, const std::vector<int>& cells,
+                  size_t next, int own_left, int opponent_left,
+                  const std::function<void(const std::vector<int>&)>& visit) {
+  if (next == cells.size()) {
+    visit(board);
+    return;
+  }
+  if (own_left > 0) {
+    board[cells[next]] = 1;
+    AssignPieces(board, cells, next + 1, own_left - 1, opponent_left, visit);
+  }
+  if (opponent_left > 0) {
+    board[cells[next]] = -1;
+    AssignPieces(board, cells, next + 1, own_left, opponent_left - 1, visit);
+  }
+  board[cells[next]] = 0;
+}
+
+// Calls visit on every canonical board with exactly empty_left empty cells
+// among the columns from column on: pieces stacked from the bottom (the last
+// row) of each column, and the player to move having as many pieces as the
+// opponent or one fewer.
+void ForEachPosition(int rows, int columns, int column, int empty_left,
+                     std::vector<int>& board, std::vector<int>& cells,
+                     const std::function<void(const std::vector<int>&)>& visit) {
+  if (column == columns) {
+    if (empty_left == 0) {
+      int num_pieces = cells.size();
+      AssignPieces(board, cells, 0, num_pieces / 2,
+                   num_pieces - num_pieces / 2, visit);
+    }
+    return;
+  }
+
+  for (int height = std::max(0, rows - empty_left); height <= rows; ++height) {
+    for (int row = rows - height; row < rows; ++row) {
+      cells.push_back(row * columns + column);
+    }
+    ForEachPosition(rows, columns, column + 1, empty_left - (rows - height),
+                    board, cells, visit);
+    cells.resize(cells.size() - height);
+  }
+}
+
+}  // namespace
+
+Tablebase::Tablebase(const std::string& path) : file_(path) {
+  TablebaseHeader header;
+  if (file_.size() < sizeof(header)) {
+    throw std::runtime_error("Tablebase file is truncated: " + path);
+  }
+  std::memcpy(&header, file_.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kTablebaseMagic, sizeof(kTablebaseMagic)) !=
+          0 ||
+      header.version != kTablebaseVersion) {
+    throw std::runtime_error("Not a tablebase file: " + path);
+  }
+
+  // Probing relies on num_slots being a power of two, and a larger count
+  // than the file has bytes would overflow the size check
+  if (header.num_slots == 0 ||
+      (header.num_slots & (header.num_slots - 1)) != 0) {
+    throw std::runtime_error("Corrupt tablebase header: " + path);
+  }
+  auto expected_size = sizeof(header) + header.num_slots * sizeof(uint64_t) +
+                       header.num_slots * sizeof(int8_t);
+  if (header.num_slots > file_.size() || file_.size() < expected_size) {
+    throw std::runtime_error("Tablebase file is truncated: " + path);
+  }
+
+  board_size_ = header.board_size;
+  action_size_ = header.action_size;
+  num_entries_ = header.num_entries;
+  slot_mask_ = header.num_slots - 1;
+  keys_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(header));
+  values_ = reinterpret_cast<const int8_t*>(keys_ + header.num_slots);
+}
+
+std::optional<int> Tablebase::Lookup(const int* cells,
+                                     size_t num_cells) const {
+  if (num_cells != board_size_ || keys_ == nullptr) {
+    return std::nullopt;
+  }
+
+  auto key = HashBoard(cells, num_cells);
+  for (auto slot = key & slot_mask_; keys_[slot] != 0;
+       slot = (slot + 1) & slot_mask_) {
+    if (keys_[slot] == key) {
+      return values_[slot];
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::unordered_map<uint64_t, int8_t> SolveEndgames(const ConnectXGame& game,
+                                                   int max_empty_cells) {
+  auto init_board = game.GetInitBoard();
+  int board_size = init_board.size();
+  int columns = game.GetValidMoves(init_board).size();
+  int rows = board_size / columns;
+
+  // Every move fills a cell, so the children of each position were all solved
+  // with the previous number of empty cells
+  std::unordered_map<uint64_t, int8_t> endgames;
+  for (int empty_cells = 1;
+       empty_cells <= std::min(max_empty_cells, board_size); ++empty_cells) {
+    std::vector<int> board(board_size, 0);
+    std::vector<int> cells;
+    ForEachPosition(rows, columns, 0, empty_cells, board, cells,
+                    [&](const std::vector<int>& position) {
+      if (game.GetRewardForPlayer(position, /*player=*/1).has_value()) {
+        return;
+      }
+
+      int8_t value = -1;
+      auto valid_moves = game.GetValidMoves(position);
+      for (size_t action = 0; action < valid_moves.size(); ++action) {
+        if (valid_moves[action] == 0) {
+          continue;
+        }
+        auto next_board = position;
+        game.PlayMove(next_board, /*player=*/1, action);
+        game.MakeCanonical(next_board, /*player=*/-1);
+        auto reward = game.GetRewardForPlayer(next_board, /*player=*/1);
+        int8_t next_value = reward.has_value()
+                                ? reward.value()
+                                : endgames.at(HashBoard(next_board));
+        value = std::max<int8_t>(value, -next_value);
+      }
+      endgames[HashBoard(position)] = value;
+    });
+  }
+  return endgames;
+}
+
+void WriteTablebase(const std::string& path, int board_size, int action_size,
+                    const std::unordered_map<uint64_t, int8_t>& values) {
+  // Keep the table at most half full so that probes stay short
+  uint64_t num_slots = 1;
+  while (num_slots < 2 * values.size()) {
+    num_slots *= 2;
+  }
+
+  std::vector<uint64_t> keys(num_slots, 0);
+  std::vector<int8_t> slot_values(num_slots, 0);
+  for (auto& entry : values) {
+    auto slot = entry.first & (num_slots - 1);
+    while (keys[slot] != 0) {
+      slot = (slot + 1) & (num_slots - 1);
+    }
+    keys[slot] = entry.first;
+    slot_values[slot] = entry.second;
+  }
+
+  TablebaseHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kTablebaseMagic, sizeof(kTablebaseMagic));
+  header.version = kTablebaseVersion;
+  header.board_size = board_size;
+  header.action_size = action_size;
+  header.num_entries = values.size();
+  header.num_slots = num_slots;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(keys.data()),
+            keys.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(slot_values.data()),
+            slot_values.size() * sizeof(int8_t));
+  if (!out) {
+    throw std::runtime_error("Could not write tablebase " + path);
+  }
+}
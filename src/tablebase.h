@@ -0,0 +1,64 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "game.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// On-disk layout: this header, then num_slots uint64_t board hashes (zero for
+// an empty slot), then num_slots int8_t values. Slots are found by linear
+// probing from HashBoard(board) modulo num_slots, which is a power of two.
+// The action size tells apart games with as many cells, e.g. 6x7 and 7x6.
+struct TablebaseHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t board_size;
+  uint32_t action_size;
+  uint32_t reserved;
+  uint64_t num_entries;
+  uint64_t num_slots;
+};
+
+// Exact values of endgame positions, memory-mapped from a file written by
+// WriteTablebase. Boards are canonical, i.e. seen by the player to move, and
+// values are from that player's perspective: 1 win, 0 draw, -1 loss.
+class Tablebase {
+ public:
+  explicit Tablebase(const std::string& path);
+
+  std::optional<int> Lookup(const int* cells, size_t num_cells) const;
+  std::optional<int> Lookup(const std::vector<int>& board) const {
+    return Lookup(board.data(), board.size());
+  }
+  uint64_t GetNumEntries() const { return num_entries_; }
+  int GetBoardSize() const { return board_size_; }
+  int GetActionSize() const { return action_size_; }
+
+ private:
+  MappedFile file_;
+  uint32_t board_size_ = 0;
+  uint32_t action_size_ = 0;
+  uint64_t num_entries_ = 0;
+  uint64_t slot_mask_ = 0;
+  const uint64_t* keys_ = nullptr;
+  const int8_t* values_ = nullptr;
+};
+
+// Solves every unfinished canonical position of the game with at most
+// max_empty_cells empty cells, enumerating them directly rather than walking
+// the game tree, and returns their values keyed by HashBoard. Positions are
+// solved from the fewest empty cells up, each from its children. Their number
+// grows combinatorially with the filled cells, so large boards only allow a
+// few empty cells.
+std::unordered_map<uint64_t, int8_t> SolveEndgames(const ConnectXGame& game,
+                                                   int max_empty_cells);
+
+void WriteTablebase(const std::string& path, int board_size, int action_size,
+                    const std::unordered_map<uint64_t, int8_t>& values);
+
+#endif /* TABLEBASE_H */
@@ -0,0 +1,207 @@
+#include "thread_budget.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Parses a kernel cpu list such as "0-3,8,10-11"
+std::vector<int> ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+const char* GetRoleName(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kSelfPlay:
+      return "self-play";
+    case ThreadRole::kTraining:
+      return "training";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+ThreadUsage GetProcessUsage() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  ThreadUsage result;
+  result.cpu_seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                       1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+  result.voluntary_switches = usage.ru_nvcsw;
+  result.involuntary_switches = usage.ru_nivcsw;
+  return result;
+}
+
+ThreadBudget::ThreadBudget(ThreadBudgetOptions options)
+    : ThreadBudget(options, GetAvailableCores()) {}
+
+ThreadBudget::ThreadBudget(ThreadBudgetOptions options, std::vector<int> cores)
+    : options_(options), cores_(std::move(cores)) {
+  int num_cores = cores_.size();
+  if (num_cores == 0) {
+    throw std::invalid_argument("No cores to schedule on");
+  }
+  if (options_.inference_threads < 1 ||
+      options_.inference_threads > num_cores) {
+    throw std::invalid_argument("inference_threads must be between 1 and " +
+                                std::to_string(num_cores));
+  }
+
+  self_play_workers_ = options_.self_play_threads > 0
+                           ? options_.self_play_threads
+                           : num_cores / options_.inference_threads;
+  if (self_play_workers_ * options_.inference_threads > num_cores) {
+    throw std::invalid_argument(
+        "Self-play needs " +
+        std::to_string(self_play_workers_ * options_.inference_threads) +
+        " cores but only " + std::to_string(num_cores) + " are available");
+  }
+
+  training_threads_ = options_.training_threads > 0 ? options_.training_threads
+                                                    : num_cores;
+  if (training_threads_ > num_cores) {
+    throw std::invalid_argument("training_threads must be at most " +
+                                std::to_string(num_cores));
+  }
+}
+
+int ThreadBudget::GetNumThreads(ThreadRole role) const {
+  return role == ThreadRole::kSelfPlay ? options_.inference_threads
+                                       : training_threads_;
+}
+
+std::vector<int> ThreadBudget::GetCores(ThreadRole role,
+                                        int worker_index) const {
+  int first = 0;
+  if (role == ThreadRole::kSelfPlay) {
+    first = (worker_index % self_play_workers_) * options_.inference_threads;
+  }
+  return std::vector<int>(cores_.begin() + first,
+                          cores_.begin() + first + GetNumThreads(role));
+}
+
+void ThreadBudget::PinCurrentThread(ThreadRole role, int worker_index) const {
+  if (!options_.pin_threads) {
+    return;
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto core : GetCores(role, worker_index)) {
+    CPU_SET(core, &cpu_set);
+  }
+  // Threads inherit their creator's affinity, so libtorch's workers started
+  // from this thread stay on the same cores.
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+void ThreadBudget::RecordUsage(ThreadRole role, const ThreadUsage& usage) {
+  usage_[static_cast<int>(role)] += usage;
+}
+
+const ThreadUsage& ThreadBudget::GetUsage(ThreadRole role) const {
+  return usage_[static_cast<int>(role)];
+}
+
+void ThreadBudget::ResetUsage() {
+  std::fill(std::begin(usage_), std::end(usage_), ThreadUsage());
+}
+
+void ThreadBudget::PrintReport(std::ostream& out) const {
+  for (auto role : {ThreadRole::kSelfPlay, ThreadRole::kTraining}) {
+    const auto& usage = GetUsage(role);
+    int role_cores = role == ThreadRole::kSelfPlay
+                         ? self_play_workers_ * options_.inference_threads
+                         : training_threads_;
+    double utilization =
+        usage.wall_seconds > 0
+            ? usage.cpu_seconds / (usage.wall_seconds * role_cores)
+            : 0;
+
+    out << GetRoleName(role) << ":\tcores " << role_cores << "\twall "
+        << usage.wall_seconds << "s\tcpu " << usage.cpu_seconds
+        << "s\tutilization " << 100 * utilization << "%\tcontext switches "
+        << usage.voluntary_switches << " voluntary, "
+        << usage.involuntary_switches << " involuntary" << std::endl;
+  }
+}
+
+std::vector<int> ThreadBudget::GetAvailableCores() {
+  std::vector<int> cores;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        cores.push_back(cpu);
+      }
+    }
+  }
+
+  // Group the cores by NUMA node. Machines without the sysfs entries are
+  // treated as a single node.
+  std::map<int, int> node_of_cpu;
+  for (int node = 0;; ++node) {
+    std::ifstream cpu_list("/sys/devices/system/node/node" +
+                           std::to_string(node) + "/cpulist");
+    if (!cpu_list) {
+      break;
+    }
+    std::string list;
+    std::getline(cpu_list, list);
+    for (auto cpu : ParseCpuList(list)) {
+      node_of_cpu[cpu] = node;
+    }
+  }
+  std::stable_sort(cores.begin(), cores.end(), [&](int a, int b) {
+    return node_of_cpu[a] < node_of_cpu[b];
+  });
+
+  return cores;
+}
+
+ScopedThreadUsage::ScopedThreadUsage(ThreadBudget& budget, ThreadRole role)
+    : budget_(budget),
+      role_(role),
+      start_time_(std::chrono::steady_clock::now()),
+      start_usage_(GetProcessUsage()) {}
+
+ScopedThreadUsage::~ScopedThreadUsage() {
+  auto end_usage = GetProcessUsage();
+
+  ThreadUsage usage;
+  usage.wall_seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start_time_)
+                           .count();
+  usage.cpu_seconds = end_usage.cpu_seconds - start_usage_.cpu_seconds;
+  usage.voluntary_switches =
+      end_usage.voluntary_switches - start_usage_.voluntary_switches;
+  usage.involuntary_switches =
+      end_usage.involuntary_switches - start_usage_.involuntary_switches;
+  budget_.RecordUsage(role_, usage);
+}
@@ -0,0 +1,107 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Self-play and training take turns by default, so each role gets the whole
+// machine while it runs. With TrainerOptions::overlap_self_play they run at
+// once, and the options should split the cores between them. Model
+// evaluations happen inside the self-play workers, on their own share of the
+// cores.
+enum class ThreadRole : int { kSelfPlay, kTraining };
+constexpr int kNumThreadRoles = 2;
+
+struct ThreadBudgetOptions {
+  // Self-play workers, each playing its own episodes. Zero fills every core.
+  int self_play_threads = 0;
+  // Cores given to each self-play worker's model evaluations, the worker's
+  // own thread included. This is libtorch's intra-op thread count during
+  // self-play.
+  int inference_threads = 1;
+  // libtorch's intra-op thread count while training. Zero uses every core.
+  int training_threads = 0;
+  // Restrict each thread to its own cores. Cores are handed out in NUMA node
+  // order, so a worker's cores, and the memory it first touches, stay on one
+  // node whenever they fit.
+  bool pin_threads = false;
+};
+
+// Resources used by the whole process while a role was running.
+struct ThreadUsage {
+  double wall_seconds = 0;
+  double cpu_seconds = 0;
+  uint64_t voluntary_switches = 0;
+  uint64_t involuntary_switches = 0;
+
+  ThreadUsage& operator+=(const ThreadUsage& other) {
+    wall_seconds += other.wall_seconds;
+    cpu_seconds += other.cpu_seconds;
+    voluntary_switches += other.voluntary_switches;
+    involuntary_switches += other.involuntary_switches;
+    return *this;
+  }
+};
+
+// CPU time and context switches of the whole process so far
+ThreadUsage GetProcessUsage();
+
+// Owns the cores the process may run on and splits them between the roles,
+// so that self-play workers and libtorch's thread pools don't oversubscribe
+// the machine between them.
+class ThreadBudget {
+ public:
+  // Splits the cores this process is allowed to run on
+  explicit ThreadBudget(ThreadBudgetOptions options);
+  // Splits the given cores, which should be listed in NUMA node order
+  ThreadBudget(ThreadBudgetOptions options, std::vector<int> cores);
+
+  int GetNumCores() const { return cores_.size(); }
+  int GetNumSelfPlayWorkers() const { return self_play_workers_; }
+  // The intra-op thread count for libtorch while the role is running
+  int GetNumThreads(ThreadRole role) const;
+  // The cores a thread of the given role runs on. Each self-play worker gets
+  // its own slice, picked by worker_index.
+  std::vector<int> GetCores(ThreadRole role, int worker_index = 0) const;
+  // Restricts the calling thread, and every thread it starts afterwards, to
+  // GetCores(role, worker_index). Does nothing unless pin_threads is set.
+  void PinCurrentThread(ThreadRole role, int worker_index = 0) const;
+
+  // Not thread-safe; usage is recorded by the thread driving the roles.
+  void RecordUsage(ThreadRole role, const ThreadUsage& usage);
+  const ThreadUsage& GetUsage(ThreadRole role) const;
+  void ResetUsage();
+  // Per-role time, utilization of the role's cores and context switches
+  void PrintReport(std::ostream& out) const;
+
+  // The cores this process is allowed to run on, in NUMA node order
+  static std::vector<int> GetAvailableCores();
+
+ private:
+  ThreadBudgetOptions options_;
+  std::vector<int> cores_;
+  int self_play_workers_ = 0;
+  int training_threads_ = 0;
+  ThreadUsage usage_[kNumThreadRoles];
+};
+
+// Records the process's resource usage between construction and destruction
+// against a role.
+class ScopedThreadUsage {
+ public:
+  ScopedThreadUsage(ThreadBudget& budget, ThreadRole role);
+  ~ScopedThreadUsage();
+
+  ScopedThreadUsage(const ScopedThreadUsage&) = delete;
+  ScopedThreadUsage& operator=(const ScopedThreadUsage&) = delete;
+
+ private:
+  ThreadBudget& budget_;
+  ThreadRole role_;
+  std::chrono::steady_clock::time_point start_time_;
+  ThreadUsage start_usage_;
+};
+
+#endif /* THREAD_BUDGET_H */
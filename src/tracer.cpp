@@ -0,0 +1,165 @@
+#include "tracer.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+  const char* name;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+// Events are stored in chunks of this many, allocated as a buffer fills
+constexpr size_t kEventsPerChunk = 4096;
+
+// Only the owning thread appends. The size is published with release
+// semantics so that a reader sees every event below it fully written.
+struct ThreadTraceBuffer {
+  int thread_id;
+  size_t capacity;
+  std::vector<std::unique_ptr<TraceEvent[]>> chunks;
+  std::atomic<size_t> size{0};
+  std::atomic<uint64_t> dropped{0};
+  // Whether a running thread owns the buffer. Those of exited threads are
+  // handed to new ones, so threads started per game or per batch don't each
+  // add a buffer.
+  bool in_use = false;
+};
+
+std::atomic<size_t> thread_buffer_capacity(1 << 18);
+std::atomic<size_t> max_total_events(1 << 22);
+// Events allocated across every buffer
+std::atomic<size_t> total_events(0);
+
+// Buffers live until the process exits, so threads may finish at any time
+std::mutex& GetRegistryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::vector<std::unique_ptr<ThreadTraceBuffer>>& GetRegistry() {
+  static std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers;
+  return buffers;
+}
+
+ThreadTraceBuffer* AcquireBuffer() {
+  std::lock_guard<std::mutex> lock(GetRegistryMutex());
+  auto& registry = GetRegistry();
+  ThreadTraceBuffer* buffer = nullptr;
+  for (auto& candidate : registry) {
+    if (!candidate->in_use) {
+      buffer = candidate.get();
+      break;
+    }
+  }
+  if (buffer == nullptr) {
+    registry.push_back(std::make_unique<ThreadTraceBuffer>());
+    buffer = registry.back().get();
+    buffer->thread_id = registry.size() - 1;
+  }
+
+  buffer->in_use = true;
+  buffer->capacity = thread_buffer_capacity.load();
+  auto num_chunks = (buffer->capacity + kEventsPerChunk - 1) / kEventsPerChunk;
+  if (buffer->chunks.size() < num_chunks) {
+    buffer->chunks.resize(num_chunks);
+  }
+  return buffer;
+}
+
+// Hands the calling thread's buffer back when the thread exits
+struct BufferLease {
+  ThreadTraceBuffer* buffer = AcquireBuffer();
+
+  ~BufferLease() {
+    std::lock_guard<std::mutex> lock(GetRegistryMutex());
+    buffer->in_use = false;
+  }
+};
+
+// Makes sure the chunk holding event index exists, unless allocating it would
+// take the buffers past max_total_events
+bool EnsureChunk(ThreadTraceBuffer& buffer, size_t index) {
+  auto& chunk = buffer.chunks[index / kEventsPerChunk];
+  if (chunk != nullptr) {
+    return true;
+  }
+  if (total_events.fetch_add(kEventsPerChunk) + kEventsPerChunk >
+      max_total_events.load(std::memory_order_relaxed)) {
+    total_events.fetch_sub(kEventsPerChunk);
+    return false;
+  }
+  chunk.reset(new TraceEvent[kEventsPerChunk]);
+  return true;
+}
+
+}  // namespace
+
+std::atomic<bool> Tracer::enabled_(false);
+
+void Tracer::Start(size_t events_per_thread, size_t max_events) {
+  thread_buffer_capacity.store(events_per_thread);
+  max_total_events.store(max_events);
+  enabled_.store(true);
+}
+
+void Tracer::Stop() { enabled_.store(false); }
+
+void Tracer::Record(const char* name, int64_t start_ns, int64_t end_ns) {
+  // Acquiring takes a lock, but only on a thread's first span
+  thread_local BufferLease lease;
+  auto buffer = lease.buffer;
+
+  auto size = buffer->size.load(std::memory_order_relaxed);
+  if (size >= buffer->capacity || !EnsureChunk(*buffer, size)) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->chunks[size / kEventsPerChunk][size % kEventsPerChunk] = {
+      name, start_ns, end_ns};
+  buffer->size.store(size + 1, std::memory_order_release);
+}
+
+void Tracer::WriteChromeTrace(const std::string& path) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + path);
+  }
+
+  // Microsecond timestamps since boot need more than the default precision
+  out << std::fixed << std::setprecision(3);
+
+  std::lock_guard<std::mutex> lock(GetRegistryMutex());
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  uint64_t dropped = 0;
+  for (auto& buffer : GetRegistry()) {
+    auto size = buffer->size.load(std::memory_order_acquire);
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+      const auto& event =
+          buffer->chunks[i / kEventsPerChunk][i % kEventsPerChunk];
+      // Complete events, with timestamps in microseconds
+      out << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+          << ",\"ts\":" << event.start_ns / 1000.0
+          << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0 << "}";
+      first = false;
+    }
+  }
+  out << "\n],\"otherData\":{\"dropped_spans\":\"" << dropped << "\"}}\n";
+}
+
+void Tracer::Clear() {
+  std::lock_guard<std::mutex> lock(GetRegistryMutex());
+  for (auto& buffer : GetRegistry()) {
+    buffer->size.store(0, std::memory_order_release);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+  }
+}
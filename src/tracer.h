@@ -0,0 +1,72 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Records timed spans from every thread and writes them in the Chrome trace
+// event format, which chrome://tracing and ui.perfetto.dev open directly.
+//
+// Spans are placed with TRACE_SPAN, which compiles to nothing unless the build
+// defines ALPHAZERO_TRACING (cmake -DENABLE_TRACING=ON). Even then nothing is
+// recorded until Start is called.
+class Tracer {
+ public:
+  // Each thread keeps up to events_per_thread spans, and all threads together
+  // up to about max_events; later ones are dropped. Buffers are allocated in
+  // chunks as they fill and reused by new threads once their thread exits.
+  static void Start(size_t events_per_thread = 1 << 18,
+                    size_t max_events = 1 << 22);
+  static void Stop();
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Appends a span to the calling thread's buffer without taking any locks
+  static void Record(const char* name, int64_t start_ns, int64_t end_ns);
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // These read or reset every thread's buffer, so no spans may be recorded
+  // while they run.
+  static void WriteChromeTrace(const std::string& path);
+  static void Clear();
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+// Records a span covering its own lifetime. name must outlive the tracer,
+// which string literals do.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char* name)
+      : name_(name), start_ns_(Tracer::IsEnabled() ? Tracer::Now() : -1) {}
+  ~ScopedSpan() {
+    if (start_ns_ >= 0) {
+      Tracer::Record(name_, start_ns_, Tracer::Now());
+    }
+  }
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+ private:
+  const char* name_;
+  int64_t start_ns_;
+};
+
+#ifdef ALPHAZERO_TRACING
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_SPAN_VARIABLE_(line) TRACE_CONCAT_(trace_span_, line)
+#define TRACE_SPAN(name) ScopedSpan TRACE_SPAN_VARIABLE_(__LINE__)(name)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#endif
+
+#endif /* TRACER_H */
@@ -1,21 +1,103 @@
 #include "trainer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+
+template <typename Game>
+std::vector<Example> BasicTrainer<Game>::ExecuteEpisode() {
+  return PlayEpisode_(this->model_, nullptr);
+}
+
+
+template <typename Game>
+std::vector<Example> BasicTrainer<Game>::ExecuteEpisode(
+    Model& model, WeightSubscriber& weights) {
+  return PlayEpisode_(model, &weights);
+}
+
+
+template <typename Game>
+std::vector<Example> BasicTrainer<Game>::ExecuteEpisode(Evaluator& evaluator) {
+  return PlayEpisode_(evaluator, nullptr);
+}
+
 
-std::vector<Example> Trainer::ExecuteEpisode() {
+template <typename Game>
+std::vector<Example> BasicTrainer<Game>::PlayEpisode_(
+    Evaluator& model, WeightSubscriber* weights) {
+  TRACE_SPAN("execute_episode");
   std::vector<Example> train_examples;
   int current_player = 1;
   auto state = this->game_.GetInitBoard();
+  GameRecord record;
+  record.action_size = this->game_.GetActionSize();
+
+  const auto& resignation = options_.resignation;
+  // Consecutive moves on which each player's root value was below the
+  // resignation threshold, indexed by player > 0
+  uint32_t low_value_moves[2] = {0, 0};
+  int resigning_player = 0;
+  bool play_out = false;
+  if (resignation.threshold > 0) {
+    thread_local std::mt19937 generator(std::random_device{}());
+    play_out = std::uniform_real_distribution<float>(0, 1)(generator) <
+               resignation.playout_fraction;
+  }
+
+  auto mcts_options = options_.mcts_options;
+  if (!options_.self_play_opening_book) {
+    mcts_options.opening_book = nullptr;
+  }
 
   while (true) {
     auto canonical_board = this->game_.GetCanonicalBoard(state, 
                                                          current_player);
-    auto mcts = MCTS(this->game_, this->model_);
-    auto root = mcts.Run(canonical_board, current_player, 
-                         options_.num_simulations);
+    uint64_t weight_version = publisher_.GetVersion();
+    if (weights != nullptr) {
+      weights->Refresh();
+      weight_version = weights->GetVersion();
+    }
+    auto mcts = BasicMCTS<Game>(this->game_, model, mcts_options);
+    auto root = std::unique_ptr<Node>(mcts.Run(
+        canonical_board, current_player,
+        std::min(options_.min_simulations, options_.num_simulations),
+        options_.num_simulations));
+    {
+      std::lock_guard<std::mutex> lock(search_stats_mutex_);
+      search_stats_ += mcts.GetStats();
+    }
     
     auto action_probs = std::vector<float>(this->game_.GetActionSize(), 0);
-    for(auto&& child : root->Children) {
-      action_probs[child->GetAction()] = child->GetVisitCount();
+    for (int i = 0; i < root->GetNumChildren(); ++i) {
+      action_probs[root->GetChildAction(i)] = root->GetChildVisitCount(i);
+    }
+
+    if (root->GetProvenValue() == ProvenValue::kWin ||
+        root->GetProvenValue() == ProvenValue::kDraw ||
+        std::accumulate(action_probs.begin(), action_probs.end(), 0.0f) == 0) {
+      // The search stops as soon as it solves the root, and a search allowed
+      // to stop early runs no simulations at all on a forced move, so the
+      // visit counts are not a useful target. Train towards the move played
+      // instead.
+      std::fill(action_probs.begin(), action_probs.end(), 0);
+      action_probs[root->SelectAction(/*temperature=*/0)] = 1;
+    }
+
+    if (options_.game_records != nullptr) {
+      record.visit_counts.push_back(QuantizeVisitCounts(action_probs));
     }
 
     // Normalize visit counts into probability distribution
@@ -30,16 +112,43 @@ std::vector<Example> Trainer::ExecuteEpisode() {
     // Adding default reward of zero for now. Once the game completes, 
     // we will correct the example with the correct reward
 
-    // TODO (Are the canonical boards correct? They don't seem to be changing properly)
-    train_examples.push_back({canonical_board, current_player, action_probs, 0});
+    train_examples.push_back(
+        {std::vector<int>(canonical_board.begin(), canonical_board.end()),
+         current_player, action_probs, 0, weight_version});
+
+    bool resign = false;
+    if (resignation.threshold > 0) {
+      // The root's value is from the point of view of the player to move
+      auto& low_moves = low_value_moves[current_player > 0];
+      low_moves = root->GetValue() < -resignation.threshold ? low_moves + 1 : 0;
+      if (resigning_player == 0 &&
+          low_moves >= std::max(1u, resignation.consecutive_moves)) {
+        resigning_player = current_player;
+        resign = !play_out;
+      }
+    }
 
-    auto action = root->SelectAction(/*temperature=*/0);
-    auto state_and_player = game_.GetNextState(state, current_player, action);
-    state = state_and_player.board;
-    current_player = state_and_player.player;
-    
-    //reward = self.game.get_reward_for_player(state, current_player)
-    auto reward = this->game_.GetRewardForPlayer(state, current_player);
+    std::optional<int> reward;
+    if (resign) {
+      // Scored as a loss for the player to move, without playing on. The
+      // position resigned in has no move, so it is left out of the examples
+      // as it is of the game record.
+      reward = -1;
+      train_examples.pop_back();
+      if (options_.game_records != nullptr) {
+        record.visit_counts.pop_back();
+      }
+    } else {
+      auto action = root->SelectAction(/*temperature=*/0);
+      record.moves.push_back(action);
+      auto state_and_player =
+          game_.GetNextState(state, current_player, action);
+      state = state_and_player.board;
+      current_player = state_and_player.player;
+
+      //reward = self.game.get_reward_for_player(state, current_player)
+      reward = this->game_.GetRewardForPlayer(state, current_player);
+    }
 
     if (reward.has_value()) {
       for(auto& example : train_examples) {
@@ -47,6 +156,29 @@ std::vector<Example> Trainer::ExecuteEpisode() {
         example.reward = reward.value() * ((example.current_player == current_player) * 1 +
                                            (example.current_player != current_player) * -1);
       }
+      ApplyTablebase_(train_examples);
+
+      if (options_.game_records != nullptr) {
+        record.result = reward.value() * current_player;
+        options_.game_records->Add(record);
+      }
+
+      SelfPlayStats stats;
+      stats.games = 1;
+      stats.moves = train_examples.size();
+      stats.resignations = resign;
+      if (resigning_player != 0 && !resign) {
+        // Played out although it would have resigned: was that a mistake?
+        int resigner_reward = resigning_player == current_player
+                                  ? reward.value()
+                                  : -reward.value();
+        stats.resignations_checked = 1;
+        stats.false_resignations = resigner_reward >= 0;
+      }
+      {
+        std::lock_guard<std::mutex> lock(search_stats_mutex_);
+        self_play_stats_ += stats;
+      }
 
       return train_examples;
     }
@@ -54,7 +186,164 @@ std::vector<Example> Trainer::ExecuteEpisode() {
 }
 
 
-void Trainer::Train(const std::vector<Example>& examples) {
+template <typename Game>
+std::vector<Example> BasicTrainer<Game>::LoadExamples(const std::string& path) {
+  std::vector<Example> examples;
+  GameRecordReader reader(path);
+  GameRecord record;
+  while (reader.Next(record)) {
+    AppendExamples(this->game_, record, examples);
+  }
+  ApplyTablebase_(examples);
+  return examples;
+}
+
+
+void TrainerBase::ApplyTablebase_(std::vector<Example>& examples) const {
+  // Solved positions get their exact value rather than this game's result
+  auto tablebase = options_.mcts_options.tablebase;
+  if (tablebase == nullptr) {
+    return;
+  }
+
+  for (auto& example : examples) {
+    auto exact_value = tablebase->Lookup(example.canonical_board);
+    if (exact_value.has_value()) {
+      example.reward = exact_value.value();
+    }
+  }
+}
+
+
+namespace {
+
+// The examples of one batch, or one replica's slice of it
+struct TrainingBatch {
+  torch::Tensor boards;
+  torch::Tensor target_pis;
+  torch::Tensor target_vis;
+  // Example::weight of each example
+  torch::Tensor weights;
+};
+
+TrainingBatch BuildBatch(const std::vector<Example>& examples,
+                         const size_t* indices, int batch_size,
+                         int board_size, int action_size,
+                         torch::Device device) {
+  TRACE_SPAN("build_batch");
+  auto opt = torch::TensorOptions().dtype(torch::kFloat32);
+  TrainingBatch batch = {torch::empty({batch_size, board_size}, opt),
+                         torch::empty({batch_size, action_size}, opt),
+                         torch::empty({batch_size}, opt),
+                         torch::empty({batch_size}, opt)};
+
+  auto boards = batch.boards.data_ptr<float>();
+  auto target_pis = batch.target_pis.data_ptr<float>();
+  auto target_vis = batch.target_vis.data_ptr<float>();
+  auto weights = batch.weights.data_ptr<float>();
+  for (int i = 0; i < batch_size; ++i) {
+    const auto& example = examples[indices[i]];
+    std::copy(example.canonical_board.begin(), example.canonical_board.end(),
+              boards + i * board_size);
+    std::copy(example.action_probs.begin(), example.action_probs.end(),
+              target_pis + i * action_size);
+    target_vis[i] = example.reward;
+    weights[i] = example.weight;
+  }
+
+  // TODO: (#13) Create Tensor on the device instead of moving it there
+  batch.boards = batch.boards.to(device);
+  batch.target_pis = batch.target_pis.to(device);
+  batch.target_vis = batch.target_vis.to(device);
+  batch.weights = batch.weights.to(device);
+  return batch;
+}
+
+void CopyParameters(torch::nn::Module& from, torch::nn::Module& to) {
+  torch::NoGradGuard guard;
+  auto from_parameters = from.parameters();
+  auto to_parameters = to.parameters();
+  for (size_t i = 0; i < from_parameters.size(); ++i) {
+    to_parameters[i].copy_(from_parameters[i]);
+  }
+}
+
+// A fixed set of threads, the calling one included, that Run hands the same
+// task to. Train keeps one for all of its batches instead of starting and
+// joining threads for each.
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_workers) {
+    for (int worker = 1; worker < num_workers; ++worker) {
+      threads_.emplace_back([this, worker] { Loop_(worker); });
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    start_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Calls task(worker) once for every worker, on the calling thread for
+  // worker 0, and returns once they have all finished
+  void Run(const std::function<void(int)>& task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      num_running_ = threads_.size();
+      ++generation_;
+    }
+    start_.notify_all();
+    task(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return num_running_ == 0; });
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const std::function<void(int)>* task_ = nullptr;
+  uint64_t generation_ = 0;
+  size_t num_running_ = 0;
+  bool stopping_ = false;
+
+  void Loop_(int worker) {
+    uint64_t generation = 0;
+    while (true) {
+      const std::function<void(int)>* task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&] {
+          return stopping_ || generation_ != generation;
+        });
+        if (stopping_) {
+          return;
+        }
+        generation = generation_;
+        task = task_;
+      }
+      (*task)(worker);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --num_running_;
+      }
+      done_.notify_one();
+    }
+  }
+};
+
+}  // namespace
+
+
+TrainingLosses TrainerBase::Train(const std::vector<Example>& examples) {
   torch::optim::AdamOptions opt;
   opt = opt.lr(5e-4);
   auto optimizer = torch::optim::Adam(this->model_.parameters(), opt);
@@ -65,61 +354,237 @@ void Trainer::Train(const std::vector<Example>& examples) {
   this->model_.train();
 
   std::cout << "NUM EXAMPLES:\t" << examples.size() << std::endl;
-  for (int i = 0; i < options_.num_epochs; ++i) {
-
-    uint32_t batch_idx = 0;
-
-    auto num_batches = static_cast<int>(examples.size() 
-                                        / options_.batch_size);
-
-    float boards[options_.batch_size][game_.GetBoardSize()];
-    float target_pis[options_.batch_size][game_.GetBoardSize()];
-    float target_vis[options_.batch_size];
-
-    while (batch_idx < num_batches) {
-      int start_idx = batch_idx * options_.batch_size;
+  if (!examples.empty()) {
+    // How many publishes behind the current weights the examples were played
+    double staleness = 0;
+    for (const auto& example : examples) {
+      staleness += publisher_.GetVersion() - example.weight_version;
+    }
+    std::cout << "Avg weight staleness:\t" << staleness / examples.size()
+              << std::endl;
+  }
 
-      // Build an input tensor
-      // TODO: (joshvarty) If anyone knows the proper way to do this,
-      // please let me know
-      for(int i = 0; i < options_.batch_size; ++i) {
-        auto i_offset = i + start_idx;
-        for(int j = 0; j < game_.GetActionSize(); ++j) {
-          boards[i][j] = static_cast<float>(examples[i_offset].canonical_board[j]);
-          target_pis[i][j] = examples[i_offset].action_probs[j];
-        }
-        target_vis[i] = examples[i].reward;
-      }
+  std::optional<PrioritizedReplay> replay;
+  std::mt19937 generator(std::rand());
+  if (options_.replay.enabled) {
+    replay.emplace(examples.size(), options_.replay);
+  }
 
-      auto opt = torch::TensorOptions().device(torch::kCPU);
-      torch::Tensor board_tensor = torch::from_blob(boards, {options_.batch_size, game_.GetActionSize()}, opt.dtype(torch::kFloat32));
-      torch::Tensor pis_tensor = torch::from_blob(target_pis, {options_.batch_size, game_.GetActionSize()}, opt.dtype(torch::kFloat32));
-      torch::Tensor vis_tensor = torch::from_blob(target_vis, {options_.batch_size}, opt.dtype(torch::kFloat32));
-      // TODO: (#13) Create Tensor on the device instead of moving it there
-      board_tensor = board_tensor.to(this->model_.device);
-      pis_tensor = pis_tensor.to(this->model_.device);
-      vis_tensor = vis_tensor.to(this->model_.device);
-
-      // Get output and loss from model
-      auto probs_and_value = this->model_.forward(board_tensor);
+  // Merged duplicates can leave fewer examples than a batch
+  uint32_t batch_size =
+      std::min<size_t>(options_.batch_size, examples.size());
+  auto num_batches =
+      batch_size == 0 ? 0 : static_cast<int>(examples.size() / batch_size);
+  int num_threads = std::max<int>(
+      1, std::min<uint32_t>(options_.data_parallel_threads, batch_size));
+
+  // Every replica thread runs its own forward and backward pass, so
+  // libtorch's intra-op threads would only oversubscribe the cores
+  int intra_op_threads = torch::get_num_threads();
+  if (num_threads > 1) {
+    torch::set_num_threads(1);
+  }
+  bool hogwild = options_.hogwild && num_threads > 1;
+  WorkerPool pool(num_threads);
+
+  // Data-parallel replica 0 is model_ itself. Hogwild threads all train
+  // private copies, as model_ is shared, each with an optimizer that keeps
+  // its moment estimates across epochs.
+  std::vector<Connect2Model> replicas;
+  std::vector<std::unique_ptr<torch::optim::Adam>> replica_optimizers;
+  int num_replicas = hogwild ? num_threads : num_threads - 1;
+  replicas.reserve(num_replicas);
+  for (int i = 0; i < num_replicas; ++i) {
+    replicas.emplace_back(board_size_, action_size_, this->model_.device);
+    replicas.back().train();
+    if (hogwild) {
+      replica_optimizers.push_back(std::make_unique<torch::optim::Adam>(
+          replicas.back().parameters(), opt));
+    }
+  }
+  auto get_replica = [&](int replica) -> Connect2Model& {
+    return replica == 0 ? this->model_ : replicas[replica - 1];
+  };
+
+  // Guards the loss history, step count and the replay buffer, which hogwild
+  // threads share
+  std::mutex mutex;
+  uint32_t num_steps = 0;
+  auto finish_step = [&](const std::vector<size_t>& indices, float l_pi,
+                         float l_vi, const torch::Tensor& example_losses) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pi_losses.push_back(l_pi);
+    v_losses.push_back(l_vi);
+    ++num_steps;
+    if (replay.has_value()) {
+      auto losses = example_losses.cpu().contiguous();
+      replay->Update(indices,
+                     std::vector<float>(losses.data_ptr<float>(),
+                                        losses.data_ptr<float>() +
+                                            losses.numel()));
+    }
+  };
+  // Only called by this thread while no worker is updating model_, so a
+  // snapshot never catches an optimizer step half way
+  uint32_t published_steps = 0;
+  auto publish_if_due = [&]() {
+    if (options_.publish_interval > 0 &&
+        num_steps / options_.publish_interval >
+            published_steps / options_.publish_interval) {
+      publisher_.Publish(this->model_);
+      published_steps = num_steps;
+    }
+  };
+  auto sample = [&](int batch_idx) {
+    std::vector<size_t> indices(batch_size);
+    std::vector<float> importance_weights;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (replay.has_value()) {
+      indices = replay->Sample(batch_size, generator);
+      importance_weights = replay->GetImportanceWeights(indices);
+    } else {
+      std::iota(indices.begin(), indices.end(), batch_idx * batch_size);
+    }
+    return std::make_pair(indices, importance_weights);
+  };
+
+  // Runs a replica on examples[indices[begin, end)], adding the gradients of
+  // its share of the batch loss to the replica's own. Returns the replica's
+  // shares of the policy and value losses and its per-example losses.
+  auto run_slice = [&](Connect2Model& model, const std::vector<size_t>& indices,
+                       const std::vector<float>& importance_weights, int begin,
+                       int end, float weight_sum) {
+    auto batch = BuildBatch(examples, indices.data() + begin, end - begin,
+                            board_size_, action_size_, this->model_.device);
+
+    torch::Tensor l_pi, l_vi, example_losses, total_loss;
+    {
+      TRACE_SPAN("forward");
+      auto probs_and_value = model.forward(batch.boards);
       auto out_pis = probs_and_value.action_probs;
       auto out_v = probs_and_value.value;
-      auto l_pi = this->GetProbabilityLoss(pis_tensor, out_pis);
-      auto l_vi = this->GetValueLoss(vis_tensor, out_v);
-      auto total_loss = l_pi + l_vi;
+      auto example_pi_losses =
+          this->GetProbabilityLosses(batch.target_pis, out_pis);
+      auto example_v_losses = this->GetValueLosses(batch.target_vis, out_v);
+      // A merged example counts as many times as the positions it stands
+      // for, which keeps the loss the same as before merging
+      l_pi = (batch.weights * example_pi_losses).sum() / weight_sum;
+      l_vi = (batch.weights * example_v_losses).sum() / weight_sum;
+      example_losses = example_pi_losses + example_v_losses;
+      if (replay.has_value()) {
+        // Undo the bias of sampling high-loss examples more often
+        auto slice_weights = std::vector<float>(
+            importance_weights.begin() + begin,
+            importance_weights.begin() + end);
+        total_loss = (torch::tensor(slice_weights).to(this->model_.device) *
+                      batch.weights * example_losses)
+                         .sum() /
+                     weight_sum;
+      } else {
+        total_loss = l_pi + l_vi;
+      }
+    }
 
-      // Backprop
-      optimizer.zero_grad();
+    {
+      TRACE_SPAN("backward");
+      model.zero_grad();
       total_loss.backward();
-      optimizer.step();
-
-      // Keep track of losses
-      auto avg_l_vi = l_vi.cpu().item<float>();
+    }
+    return std::make_tuple(l_pi.detach(), l_vi.detach(),
+                           example_losses.detach());
+  };
+  auto get_weight_sum = [&](const std::vector<size_t>& indices) {
+    float weight_sum = 0;
+    for (auto index : indices) {
+      weight_sum += examples[index].weight;
+    }
+    return weight_sum;
+  };
 
-      pi_losses.push_back(l_pi.cpu().item<float>());
-      v_losses.push_back(l_vi.cpu().item<float>());
+  for (int i = 0; i < options_.num_epochs; ++i) {
+    if (hogwild) {
+      // Each thread trains on whole batches with its own optimizer and adds
+      // its updates to model_ without any locking
+      std::atomic<int> next_batch(0);
+      pool.Run([&](int replica_index) {
+        auto& replica = replicas[replica_index];
+        auto& replica_optimizer = *replica_optimizers[replica_index];
+        auto shared_parameters = this->model_.parameters();
+        auto parameters = replica.parameters();
+
+        int batch_idx;
+        while ((batch_idx = next_batch++) < num_batches) {
+          auto sampled = sample(batch_idx);
+          CopyParameters(this->model_, replica);
+          std::vector<torch::Tensor> start;
+          for (auto& parameter : parameters) {
+            start.push_back(parameter.detach().clone());
+          }
+
+          auto losses = run_slice(replica, sampled.first, sampled.second, 0,
+                                  batch_size, get_weight_sum(sampled.first));
+          {
+            TRACE_SPAN("optimizer_step");
+            replica_optimizer.step();
+            torch::NoGradGuard guard;
+            for (size_t j = 0; j < parameters.size(); ++j) {
+              shared_parameters[j].add_(parameters[j] - start[j]);
+            }
+          }
+          finish_step(sampled.first, std::get<0>(losses).item<float>(),
+                      std::get<1>(losses).item<float>(), std::get<2>(losses));
+        }
+      });
+      // Hogwild threads update model_ until they join, so their steps are
+      // published once per epoch at most
+      publish_if_due();
+    } else {
+      for (int batch_idx = 0; batch_idx < num_batches; ++batch_idx) {
+        auto sampled = sample(batch_idx);
+        float weight_sum = get_weight_sum(sampled.first);
+
+        // Each replica takes a contiguous slice of the batch. Their losses
+        // are scaled by the whole batch's weight, so the sum of their
+        // gradients is the gradient of the batch loss.
+        std::vector<std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>>
+            slices(num_threads);
+        pool.Run([&](int replica) {
+          if (replica > 0) {
+            CopyParameters(this->model_, get_replica(replica));
+          }
+          slices[replica] = run_slice(
+              get_replica(replica), sampled.first, sampled.second,
+              batch_size * replica / num_threads,
+              batch_size * (replica + 1) / num_threads, weight_sum);
+        });
+
+        if (num_threads > 1) {
+          TRACE_SPAN("all_reduce");
+          torch::NoGradGuard guard;
+          auto parameters = this->model_.parameters();
+          for (auto& replica : replicas) {
+            auto replica_parameters = replica.parameters();
+            for (size_t j = 0; j < parameters.size(); ++j) {
+              parameters[j].grad().add_(replica_parameters[j].grad());
+            }
+          }
+        }
+        {
+          TRACE_SPAN("optimizer_step");
+          optimizer.step();
+        }
 
-      ++batch_idx;
+        float l_pi = 0;
+        float l_vi = 0;
+        std::vector<torch::Tensor> example_losses;
+        for (auto& slice : slices) {
+          l_pi += std::get<0>(slice).item<float>();
+          l_vi += std::get<1>(slice).item<float>();
+          example_losses.push_back(std::get<2>(slice));
+        }
+        finish_step(sampled.first, l_pi, l_vi, torch::cat(example_losses));
+        publish_if_due();
+      }
     }
 
     auto avg_p_loss = std::accumulate(pi_losses.begin(), pi_losses.end(), 0.0) / pi_losses.size();
@@ -127,45 +592,218 @@ void Trainer::Train(const std::vector<Example>& examples) {
     std::cout << "Avg p_loss:\t" << avg_p_loss << std::endl;
     std::cout << "Avg v_loss:\t" << avg_v_loss << std::endl;
   }
+
+  if (num_threads > 1) {
+    torch::set_num_threads(intra_op_threads);
+  }
+  if (num_steps == 0 || published_steps != num_steps) {
+    publisher_.Publish(this->model_);
+  }
+
+  TrainingLosses losses;
+  losses.steps = num_steps;
+  if (!pi_losses.empty()) {
+    losses.policy = std::accumulate(pi_losses.begin(), pi_losses.end(), 0.0) /
+                    pi_losses.size();
+    losses.value = std::accumulate(v_losses.begin(), v_losses.end(), 0.0) /
+                   v_losses.size();
+  }
+  return losses;
 }
 
 
-void Trainer::Learn() {
-  for(uint32_t i = 0; i < options_.training_iterations; ++i) {
+template <typename Game>
+uint32_t BasicTrainer<Game>::Learn() {
+  auto start_time = std::chrono::steady_clock::now();
+  auto start_cpu_seconds = GetProcessUsage().cpu_seconds;
+  auto thread_budget = options_.thread_budget;
+  auto out_of_budget = [&]() {
+    std::chrono::duration<double> wall_seconds =
+        std::chrono::steady_clock::now() - start_time;
+    return (options_.max_wall_seconds > 0 &&
+            wall_seconds.count() >= options_.max_wall_seconds) ||
+           (options_.max_cpu_seconds > 0 &&
+            GetProcessUsage().cpu_seconds - start_cpu_seconds >=
+                options_.max_cpu_seconds);
+  };
+
+  // Plays an iteration's episodes. Each worker plays with its own copy of the
+  // model, refreshed from publisher_ before every move, so while Train runs
+  // alongside, they pick up its weights as they are published.
+  auto play_episodes = [&]() {
+    std::vector<Example> training_examples;
+    std::optional<ScopedThreadUsage> usage;
+    int num_workers = 1;
+    if (thread_budget != nullptr) {
+      usage.emplace(*thread_budget, ThreadRole::kSelfPlay);
+      num_workers = thread_budget->GetNumSelfPlayWorkers();
+      // libtorch's intra-op pool is shared by the whole process, so while
+      // training runs alongside it keeps the training thread count
+      if (!options_.overlap_self_play) {
+        torch::set_num_threads(
+            thread_budget->GetNumThreads(ThreadRole::kSelfPlay));
+      }
+    }
+
+    TRACE_SPAN("self_play");
+    // Workers take episodes until there are none left
+    std::atomic<uint32_t> next_episode(0);
+    std::mutex examples_mutex;
+    auto play = [&](int worker_index) {
+      if (thread_budget != nullptr) {
+        thread_budget->PinCurrentThread(ThreadRole::kSelfPlay, worker_index);
+      }
+      auto model = Connect2Model(board_size_, action_size_,
+                                 this->model_.device);
+      WeightSubscriber weights(publisher_, model);
+      while (next_episode++ < options_.num_episodes) {
+        auto iter_training_examples = this->ExecuteEpisode(model, weights);
+        std::lock_guard<std::mutex> lock(examples_mutex);
+        training_examples.insert(training_examples.end(),
+                                 iter_training_examples.begin(),
+                                 iter_training_examples.end());
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (int worker_index = 1; worker_index < num_workers; ++worker_index) {
+      workers.emplace_back(play, worker_index);
+    }
+    play(/*worker_index=*/0);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    return training_examples;
+  };
+
+  // With overlap_self_play, the next iteration's episodes are played here
+  // while the current one trains
+  std::future<std::vector<Example>> next_examples;
+  // Reports and traces are only written while no self-play is running
+  auto write_report = [&]() {
+    if (thread_budget != nullptr) {
+      thread_budget->PrintReport(std::cout);
+      thread_budget->ResetUsage();
+    }
+    if (!options_.trace_path.empty() && Tracer::IsEnabled()) {
+      Tracer::WriteChromeTrace(options_.trace_path);
+      Tracer::Clear();
+    }
+  };
+
+  uint32_t i = 0;
+  for(; i < options_.training_iterations; ++i) {
+    // Episodes already being played were started within the budget
+    if (!next_examples.valid() && out_of_budget()) {
+      break;
+    }
+
     std::cout << i << "/" << options_.training_iterations << std::endl;
 
     std::vector<Example> training_examples;
+    if (next_examples.valid()) {
+      training_examples = next_examples.get();
+      write_report();
+    } else {
+      training_examples = play_episodes();
+    }
+
+    std::cout << "Simulations run:\t" << search_stats_.simulations
+              << "\tsaved:\t" << search_stats_.simulations_saved
+              << std::endl;
+    std::cout << "Peak nodes per tree:\t" << search_stats_.peak_tree_nodes
+              << "\tlive:\t" << search_stats_.peak_live_nodes << " ("
+              << search_stats_.peak_live_nodes * Node::GetBytesPerNode() / 1024
+              << " KiB)\tcreated:\t" << search_stats_.nodes_created
+              << "\tpruned:\t" << search_stats_.nodes_pruned
+              << "\texpansions skipped:\t" << search_stats_.expansions_skipped
+              << std::endl;
+    search_stats_ = SearchStats();
+    if (self_play_stats_.games > 0) {
+      std::cout << "Avg game length:\t"
+                << static_cast<double>(self_play_stats_.moves) /
+                       self_play_stats_.games
+                << "\tresigned:\t" << self_play_stats_.resignations << "/"
+                << self_play_stats_.games << "\tfalse resignations:\t"
+                << self_play_stats_.false_resignations << "/"
+                << self_play_stats_.resignations_checked << " ("
+                << 100 * self_play_stats_.GetFalseResignationRate() << "%)"
+                << std::endl;
+    }
+    self_play_stats_ = SelfPlayStats();
 
-    for (uint32_t episode = 0; episode < options_.num_episodes; ++episode) {
-      auto iter_training_examples = this->ExecuteEpisode();
-      training_examples.insert(training_examples.end(), 
-                               iter_training_examples.begin(),
-                               iter_training_examples.end());
+    if (options_.overlap_self_play && i + 1 < options_.training_iterations &&
+        !out_of_budget()) {
+      next_examples = std::async(std::launch::async, play_episodes);
+    }
+
+    {
+      std::optional<ScopedThreadUsage> usage;
+      int num_threads = std::thread::hardware_concurrency();
+      if (thread_budget != nullptr) {
+        usage.emplace(*thread_budget, ThreadRole::kTraining);
+        num_threads = thread_budget->GetNumThreads(ThreadRole::kTraining);
+        torch::set_num_threads(num_threads);
+        thread_budget->PinCurrentThread(ThreadRole::kTraining);
+      }
+      if (options_.merge_duplicates) {
+        TRACE_SPAN("merge_duplicates");
+        auto num_positions = training_examples.size();
+        training_examples =
+            MergeDuplicateExamples(training_examples, num_threads);
+        std::cout << "Unique positions:\t" << training_examples.size()
+                  << " of " << num_positions << std::endl;
+      }
+      std::random_shuffle(training_examples.begin(), training_examples.end());
+      TRACE_SPAN("train");
+      this->Train(training_examples);
+    }
+
+    if (!options_.weight_file_path.empty()) {
+      TRACE_SPAN("export_weights");
+      auto temp_path = options_.weight_file_path + ".tmp";
+      ExportWeights(this->model_, temp_path);
+      std::rename(temp_path.c_str(), options_.weight_file_path.c_str());
     }
 
-    std::random_shuffle(training_examples.begin(), training_examples.end());
-    this->Train(training_examples);
     // TODO (joshvarty): Probably want to let people change this?
     std::string kFileName = "checkpoint";
     //this->SaveCheckpoint("checkpoints", kFileName);
+
+    if (!next_examples.valid()) {
+      write_report();
+    }
   }
+
+  return i;
 }
 
 
-torch::Tensor Trainer::GetProbabilityLoss(torch::Tensor targets,
+torch::Tensor TrainerBase::GetProbabilityLoss(torch::Tensor targets,
                                           torch::Tensor outputs) {
-  auto loss = -(targets * torch::log(outputs)).sum(1);
-  return loss.mean();
+  return GetProbabilityLosses(targets, outputs).mean();
 }
 
-torch::Tensor Trainer::GetValueLoss(torch::Tensor targets,
+torch::Tensor TrainerBase::GetValueLoss(torch::Tensor targets,
                                     torch::Tensor outputs) {
   // loss = torch.sum((targets-outputs.view(-1))**2)/targets.size()[0]
-  auto loss = torch::sum((targets - outputs).view(-1).pow(2)) / targets.size(0);
-  return loss;
+  return GetValueLosses(targets, outputs).mean();
+}
+
+torch::Tensor TrainerBase::GetProbabilityLosses(torch::Tensor targets,
+                                                torch::Tensor outputs) {
+  return -(targets * torch::log(outputs)).sum(1);
 }
 
-void Trainer::SaveCheckpoint(std::string folder, std::string filename) {
+torch::Tensor TrainerBase::GetValueLosses(torch::Tensor targets,
+                                          torch::Tensor outputs) {
+  // The model's values are {batch_size, 1} against {batch_size} targets, which
+  // would broadcast to {batch_size, batch_size} if subtracted as they are
+  return (targets - outputs.view(-1)).pow(2);
+}
+
+void TrainerBase::SaveCheckpoint(std::string folder, std::string filename) {
+  TRACE_SPAN("checkpoint");
   // if (!std::experimental::filesystem::exists(folder)) {
   //   std::experimental::filesystem::create_directory(folder);
   // }
@@ -175,3 +813,7 @@ void Trainer::SaveCheckpoint(std::string folder, std::string filename) {
 
   // torch::save(this->model_, path.string());
 }
+
+template class BasicTrainer<Connect2Game>;
+template class BasicTrainer<FixedConnect2Game>;
+template class BasicTrainer<FixedConnect4Game>;
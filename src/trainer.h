@@ -1,20 +1,62 @@
 #ifndef TRAINER_H
 #define TRAINER_H
 
+#include "example.h"
 #include "game.h"
+#include "game_record.h"
 #include "model.h"
 #include "monte_carlo_tree_search.h"
+#include "prioritized_replay.h"
+#include "tablebase.h"
+#include "thread_budget.h"
+#include "tracer.h"
+#include "weight_export.h"
+#include "weight_publisher.h"
 
 #include <experimental/filesystem>
+#include <limits>
+#include <mutex>
 #include <torch/torch.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
-struct Example {
-  std::vector<int> canonical_board;
-  int current_player;
-  std::vector<float> action_probs;
-  int reward;
+struct ResignationOptions {
+  // Zero never resigns. Otherwise a self-play game ends as a loss for the
+  // player to move once its root value has been below -threshold on
+  // consecutive_moves of its moves in a row. Zero consecutive_moves counts
+  // as one.
+  float threshold = 0;
+  uint32_t consecutive_moves = 3;
+  // This fraction of the games that would resign is played to the end
+  // instead, to measure how often resigning was a mistake
+  float playout_fraction = 0.1;
+};
+
+// The self-play games of an iteration
+struct SelfPlayStats {
+  uint64_t games = 0;
+  uint64_t moves = 0;
+  uint64_t resignations = 0;
+  // Games played out although they would have resigned, and how many of
+  // them the resigning player went on to draw or win
+  uint64_t resignations_checked = 0;
+  uint64_t false_resignations = 0;
+
+  double GetFalseResignationRate() const {
+    return resignations_checked == 0
+               ? 0
+               : static_cast<double>(false_resignations) /
+                     resignations_checked;
+  }
+
+  SelfPlayStats& operator+=(const SelfPlayStats& other) {
+    games += other.games;
+    moves += other.moves;
+    resignations += other.resignations;
+    resignations_checked += other.resignations_checked;
+    false_resignations += other.false_resignations;
+    return *this;
+  }
 };
 
 struct TrainerOptions {
@@ -22,29 +64,151 @@ struct TrainerOptions {
   uint32_t num_episodes;
   uint32_t num_epochs;
   uint32_t num_simulations;
+  // Below num_simulations, searches may stop once the chosen move can no
+  // longer change, but never before this many simulations. By default every
+  // search runs all num_simulations.
+  uint32_t min_simulations = std::numeric_limits<uint32_t>::max();
   uint32_t training_iterations;
+  MCTSOptions mcts_options;
+  // Splits the cores between self-play workers and training and sizes
+  // libtorch's thread pools to match. Without one, episodes are played one at
+  // a time and libtorch keeps its own defaults.
+  ThreadBudget* thread_budget = nullptr;
+  // Every self-play game is also appended here, to be replayed later with
+  // LoadExamples.
+  GameRecordWriter* game_records = nullptr;
+  // When the Tracer is running, the spans of each training iteration are
+  // written here, replacing the previous iteration's.
+  std::string trace_path;
+  // Learn stops before starting an iteration once either budget, counted
+  // from the start of Learn, is spent. Zero means no limit.
+  double max_wall_seconds = 0;
+  double max_cpu_seconds = 0;
+  // Training publishes its weights to the self-play workers after every this
+  // many optimizer steps, as well as at the end of each Train. Zero only
+  // publishes at the end. Hogwild training publishes between epochs, once
+  // its threads have joined. Workers only see publishes made while they play,
+  // i.e. with overlap_self_play.
+  uint32_t publish_interval = 0;
+  // Learn plays the next iteration's episodes while the current one trains,
+  // instead of taking turns. The workers pick up each publish between moves,
+  // so the examples of an iteration come from several weight versions. The
+  // thread budget should then split the cores between self-play and
+  // training, which also share libtorch's intra-op thread count (the
+  // training one), and their reported usage overlaps.
+  bool overlap_self_play = false;
+  // Sampling of the examples within each Train
+  PrioritizedReplayOptions replay;
+  // Merge the examples of each iteration that share a canonical board before
+  // training on them. See MergeDuplicateExamples.
+  bool merge_duplicates = false;
+  // Train splits each batch between this many model replicas, one thread
+  // each, and sums their gradients before a single optimizer step. The
+  // result matches training on one thread up to rounding.
+  uint32_t data_parallel_threads = 1;
+  // Instead of splitting batches, each of the data_parallel_threads trains
+  // whole batches on its own replica and optimizer and adds its updates to
+  // the shared weights without locking. Scales further, but the updates race.
+  bool hogwild = false;
+  // After every Train, the weights are exported here for MappedConnect2Model.
+  // The file is replaced by a rename, so processes that have the previous
+  // one mapped keep reading it undisturbed.
+  std::string weight_file_path;
+  ResignationOptions resignation;
+  // Self-play only answers positions from mcts_options.opening_book when this
+  // is set. Book moves are cheap but their policy targets come from whatever
+  // built the book rather than from the current network's search.
+  bool self_play_opening_book = false;
+};
+
+// The losses of a Train, averaged over its steps
+struct TrainingLosses {
+  double policy = 0;
+  double value = 0;
+  uint32_t steps = 0;
 };
 
-class Trainer {
+// The parts of training that don't depend on the game being played
+class TrainerBase {
   public:
-    Trainer(Connect2Game game, Connect2Model model, TrainerOptions options) : 
-      game_(game), 
+    TrainerBase(Connect2Model model, TrainerOptions options, int board_size,
+                int action_size) :
       model_(model),
-      options_(options) {}
+      options_(options),
+      board_size_(board_size),
+      action_size_(action_size) {
+      publisher_.Publish(model_);
+    }
 
-    std::vector<Example> ExecuteEpisode();
-    void Learn();
-    void Train(const std::vector<Example>& examples);
+    TrainingLosses Train(const std::vector<Example>& examples);
     torch::Tensor GetProbabilityLoss(torch::Tensor targets,
                                      torch::Tensor outputs);
     torch::Tensor GetValueLoss(torch::Tensor targets,
                                torch::Tensor outputs);
+    // The losses of each example in the batch, which the two above average
+    torch::Tensor GetProbabilityLosses(torch::Tensor targets,
+                                       torch::Tensor outputs);
+    torch::Tensor GetValueLosses(torch::Tensor targets,
+                                 torch::Tensor outputs);
     void SaveCheckpoint(std::string folder, std::string filename);
+    Connect2Model& GetModel() { return model_; }
+    const WeightPublisher& GetPublisher() const { return publisher_; }
+    // Of the games played since the last Learn iteration finished self-play
+    const SelfPlayStats& GetSelfPlayStats() const { return self_play_stats_; }
 
-  private:
-    Connect2Game game_;
+  protected:
+    // Replaces the reward of every example the tablebase has solved
+    void ApplyTablebase_(std::vector<Example>& examples) const;
+
+    // Only ever used by the training thread. Self-play workers play with
+    // their own copies, kept up to date through publisher_.
     Connect2Model model_;
+    WeightPublisher publisher_;
     TrainerOptions options_;
+    SearchStats search_stats_;
+    SelfPlayStats self_play_stats_;
+    // Self-play workers add to both stats concurrently
+    std::mutex search_stats_mutex_;
+    int board_size_;
+    int action_size_;
 };
 
+// Self-play and training for any game usable with BasicMCTS. The game is held
+// by value and searched with BasicMCTS<Game>, so a FixedConnectXGame compiles
+// to a fully devirtualized self-play loop.
+template <typename Game>
+class BasicTrainer : public TrainerBase {
+  public:
+    BasicTrainer(Game game, Connect2Model model, TrainerOptions options) :
+      TrainerBase(model, options, game.GetBoardSize(), game.GetActionSize()),
+      game_(game) {}
+
+    // Plays a game with the trainer's own model
+    std::vector<Example> ExecuteEpisode();
+    // Plays a game with a worker's model, picking up newly published weights
+    // before every move
+    std::vector<Example> ExecuteEpisode(Model& model,
+                                        WeightSubscriber& weights);
+    // Plays a game with any evaluator, e.g. a RolloutEvaluator to generate
+    // examples before the network is any good
+    std::vector<Example> ExecuteEpisode(Evaluator& evaluator);
+    // Regenerates the examples of every game in a file of game records
+    std::vector<Example> LoadExamples(const std::string& path);
+    // Returns the number of training iterations run
+    uint32_t Learn();
+
+  private:
+    Game game_;
+
+    std::vector<Example> PlayEpisode_(Evaluator& model,
+                                      WeightSubscriber* weights);
+};
+
+// The instantiations compiled in trainer.cpp
+extern template class BasicTrainer<Connect2Game>;
+extern template class BasicTrainer<FixedConnect2Game>;
+extern template class BasicTrainer<FixedConnect4Game>;
+
+using Trainer = BasicTrainer<Connect2Game>;
+
 #endif /* TRAINER_H */
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "weight_export.h"
+
+#include "weight_file.h"
+
+#include <vector>
+
+void ExportWeights(const torch::nn::Module& module, const std::string& path) {
+  std::vector<WeightTensor> tensors;
+  auto add_tensor = [&](const std::string& name, const torch::Tensor& tensor) {
+    auto values = tensor.detach().to(torch::kCPU, torch::kFloat32).contiguous();
+    tensors.push_back({name,
+                       std::vector<int64_t>(values.sizes().begin(),
+                                            values.sizes().end()),
+                       std::vector<float>(values.data_ptr<float>(),
+                                          values.data_ptr<float>() +
+                                              values.numel())});
+  };
+  for (const auto& parameter : module.named_parameters()) {
+    add_tensor(parameter.key(), parameter.value());
+  }
+  for (const auto& buffer : module.named_buffers()) {
+    add_tensor(buffer.key(), buffer.value());
+  }
+  WriteWeightFile(path, tensors);
+}
@@ -0,0 +1,13 @@
+#ifndef WEIGHT_EXPORT_H
+#define WEIGHT_EXPORT_H
+
+#include <torch/torch.h>
+
+#include <string>
+
+// Writes every parameter and buffer of the module, under its dotted name, to
+// a weight file for MappedConnect2Model. Tensors are copied to the CPU as
+// float32 first.
+void ExportWeights(const torch::nn::Module& module, const std::string& path);
+
+#endif /* WEIGHT_EXPORT_H */
@@ -0,0 +1,153 @@
+#include "weight_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const char kWeightFileMagic[8] = {'A', 'Z', 'W', 'E', 'I', 'G', 'H', 'T'};
+const uint32_t kWeightFileVersion = 1;
+
+uint64_t AlignUp(uint64_t offset) {
+  return (offset + kWeightAlignment - 1) / kWeightAlignment * kWeightAlignment;
+}
+
+std::string GetShapeString(const int64_t* shape, size_t rank) {
+  std::string result = "[";
+  for (size_t i = 0; i < rank; ++i) {
+    result += (i == 0 ? "" : ", ") + std::to_string(shape[i]);
+  }
+  return result + "]";
+}
+
+}  // namespace
+
+void WriteWeightFile(const std::string& path,
+                     const std::vector<WeightTensor>& tensors) {
+  WeightFileHeader header;
+  std::memcpy(header.magic, kWeightFileMagic, sizeof(kWeightFileMagic));
+  header.version = kWeightFileVersion;
+  header.num_tensors = tensors.size();
+
+  std::vector<WeightFileEntry> entries(tensors.size());
+  uint64_t offset =
+      AlignUp(sizeof(header) + entries.size() * sizeof(WeightFileEntry));
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const auto& tensor = tensors[i];
+    auto& entry = entries[i];
+    std::memset(&entry, 0, sizeof(entry));
+    if (tensor.name.size() >= sizeof(entry.name) ||
+        tensor.shape.size() > kMaxWeightRank) {
+      throw std::invalid_argument("Cannot store tensor " + tensor.name);
+    }
+    std::memcpy(entry.name, tensor.name.data(), tensor.name.size());
+
+    entry.rank = tensor.shape.size();
+    uint64_t num_elements = 1;
+    for (size_t j = 0; j < tensor.shape.size(); ++j) {
+      entry.shape[j] = tensor.shape[j];
+      num_elements *= tensor.shape[j];
+    }
+    if (num_elements != tensor.values.size()) {
+      throw std::invalid_argument("Shape doesn't match the values of " +
+                                  tensor.name);
+    }
+    entry.num_elements = num_elements;
+    entry.offset = offset;
+    offset = AlignUp(offset + num_elements * sizeof(float));
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(entries.data()),
+            entries.size() * sizeof(WeightFileEntry));
+  const char padding[kWeightAlignment] = {};
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    out.write(padding, entries[i].offset - out.tellp());
+    out.write(reinterpret_cast<const char*>(tensors[i].values.data()),
+              tensors[i].values.size() * sizeof(float));
+  }
+  if (!out) {
+    throw std::runtime_error("Could not write weight file " + path);
+  }
+}
+
+WeightFile::WeightFile(const std::string& path) : file_(path) {
+  WeightFileHeader header;
+  if (file_.size() < sizeof(header)) {
+    throw std::runtime_error("Weight file is truncated: " + path);
+  }
+  std::memcpy(&header, file_.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kWeightFileMagic, sizeof(kWeightFileMagic)) !=
+          0 ||
+      header.version != kWeightFileVersion) {
+    throw std::runtime_error("Not a weight file: " + path);
+  }
+
+  num_tensors_ = header.num_tensors;
+  if (num_tensors_ > file_.size() ||
+      file_.size() < sizeof(header) + num_tensors_ * sizeof(WeightFileEntry)) {
+    throw std::runtime_error("Weight file is truncated: " + path);
+  }
+  entries_ =
+      reinterpret_cast<const WeightFileEntry*>(file_.data() + sizeof(header));
+  // Every entry is checked once here, so that GetShape and Get can trust
+  // them. Sizes are compared by division to stay clear of overflow.
+  uint64_t max_elements = file_.size() / sizeof(float);
+  for (size_t i = 0; i < num_tensors_; ++i) {
+    const auto& entry = entries_[i];
+    if (entry.rank > static_cast<uint32_t>(kMaxWeightRank)) {
+      throw std::runtime_error("Corrupt weight file entry: " + path);
+    }
+    uint64_t num_elements = 1;
+    for (uint32_t j = 0; j < entry.rank; ++j) {
+      uint64_t dim = static_cast<uint64_t>(entry.shape[j]);
+      if (entry.shape[j] < 0 ||
+          (dim > 0 && num_elements > max_elements / dim)) {
+        throw std::runtime_error("Corrupt weight file entry: " + path);
+      }
+      num_elements *= dim;
+    }
+    if (num_elements != entry.num_elements) {
+      throw std::runtime_error("Corrupt weight file entry: " + path);
+    }
+    if (entry.offset % kWeightAlignment != 0 || entry.offset > file_.size() ||
+        entry.num_elements > (file_.size() - entry.offset) / sizeof(float)) {
+      throw std::runtime_error("Weight file is truncated: " + path);
+    }
+  }
+}
+
+const WeightFileEntry* WeightFile::Find_(const std::string& name) const {
+  for (size_t i = 0; i < num_tensors_; ++i) {
+    if (std::strncmp(entries_[i].name, name.c_str(),
+                     sizeof(entries_[i].name)) == 0) {
+      return &entries_[i];
+    }
+  }
+  return nullptr;
+}
+
+std::vector<int64_t> WeightFile::GetShape(const std::string& name) const {
+  auto entry = Find_(name);
+  if (entry == nullptr) {
+    throw std::runtime_error("No tensor named " + name);
+  }
+  return std::vector<int64_t>(entry->shape, entry->shape + entry->rank);
+}
+
+const float* WeightFile::Get(const std::string& name,
+                             const std::vector<int64_t>& shape) const {
+  auto entry = Find_(name);
+  if (entry == nullptr) {
+    throw std::runtime_error("No tensor named " + name);
+  }
+  if (shape != GetShape(name)) {
+    throw std::runtime_error(
+        name + " has shape " + GetShapeString(entry->shape, entry->rank) +
+        " instead of " + GetShapeString(shape.data(), shape.size()));
+  }
+  return reinterpret_cast<const float*>(file_.data() + entry->offset);
+}
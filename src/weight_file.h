@@ -0,0 +1,67 @@
+#ifndef WEIGHT_FILE_H
+#define WEIGHT_FILE_H
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk layout: this header, then num_tensors WeightFileEntry records, then
+// the float32 values of each tensor in row-major order. Every tensor starts on
+// a kWeightAlignment byte boundary of the file, and so of its mapping, so that
+// inference can read the values in place with aligned vector loads.
+struct WeightFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_tensors;
+};
+
+constexpr int kMaxWeightRank = 4;
+constexpr size_t kWeightAlignment = 64;
+
+struct WeightFileEntry {
+  // Null-terminated, e.g. "fc1.weight"
+  char name[56];
+  uint32_t rank;
+  uint32_t reserved;
+  int64_t shape[kMaxWeightRank];
+  // Byte offset of the values from the start of the file
+  uint64_t offset;
+  uint64_t num_elements;
+};
+
+struct WeightTensor {
+  std::string name;
+  std::vector<int64_t> shape;
+  std::vector<float> values;
+};
+
+void WriteWeightFile(const std::string& path,
+                     const std::vector<WeightTensor>& tensors);
+
+// The tensors of a file written by WriteWeightFile, mapped read-only. Opening
+// one only validates the header and entries; the values are paged in as they
+// are first read and shared with every other process mapping the same file.
+class WeightFile {
+ public:
+  explicit WeightFile(const std::string& path);
+
+  size_t GetNumTensors() const { return num_tensors_; }
+  bool Has(const std::string& name) const { return Find_(name) != nullptr; }
+  std::vector<int64_t> GetShape(const std::string& name) const;
+  // The values of the named tensor, which must have exactly this shape.
+  // Valid for as long as the WeightFile is.
+  const float* Get(const std::string& name,
+                   const std::vector<int64_t>& shape) const;
+
+ private:
+  MappedFile file_;
+  const WeightFileEntry* entries_ = nullptr;
+  size_t num_tensors_ = 0;
+
+  const WeightFileEntry* Find_(const std::string& name) const;
+};
+
+#endif /* WEIGHT_FILE_H */
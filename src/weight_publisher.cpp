@@ -0,0 +1,53 @@
+#include "weight_publisher.h"
+
+#include <stdexcept>
+
+uint64_t WeightPublisher::Publish(const torch::nn::Module& model) {
+  torch::NoGradGuard guard;
+
+  auto snapshot = std::make_shared<WeightSnapshot>();
+  snapshot->version = version_.load(std::memory_order_relaxed) + 1;
+  for (const auto& parameter : model.named_parameters()) {
+    snapshot->tensors.emplace_back(parameter.key(), parameter.value().clone());
+  }
+  for (const auto& buffer : model.named_buffers()) {
+    snapshot->tensors.emplace_back(buffer.key(), buffer.value().clone());
+  }
+
+  // Readers check the version first, so the snapshot has to be in place
+  // before it changes.
+  std::atomic_store(&latest_,
+                    std::shared_ptr<const WeightSnapshot>(std::move(snapshot)));
+  version_.fetch_add(1, std::memory_order_release);
+  return GetVersion();
+}
+
+bool WeightSubscriber::Refresh() {
+  if (publisher_.GetVersion() == version_) {
+    return false;
+  }
+
+  auto snapshot = publisher_.GetLatest();
+  torch::NoGradGuard guard;
+
+  size_t i = 0;
+  auto load = [&](const std::string& name, torch::Tensor& tensor) {
+    if (i == snapshot->tensors.size() || snapshot->tensors[i].first != name ||
+        snapshot->tensors[i].second.sizes() != tensor.sizes()) {
+      throw std::runtime_error("Published weights don't match tensor " + name);
+    }
+    tensor.copy_(snapshot->tensors[i++].second);
+  };
+  for (auto& parameter : model_.named_parameters()) {
+    load(parameter.key(), parameter.value());
+  }
+  for (auto& buffer : model_.named_buffers()) {
+    load(buffer.key(), buffer.value());
+  }
+  if (i != snapshot->tensors.size()) {
+    throw std::runtime_error("Published weights have extra tensors");
+  }
+
+  version_ = snapshot->version;
+  return true;
+}
@@ -0,0 +1,62 @@
+#ifndef WEIGHT_PUBLISHER_H
+#define WEIGHT_PUBLISHER_H
+
+#include <torch/torch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// An immutable copy of a model's parameters and buffers, in the order the
+// model lists them
+struct WeightSnapshot {
+  uint64_t version = 0;
+  std::vector<std::pair<std::string, torch::Tensor>> tensors;
+};
+
+// Hands the trainer's weights to self-play workers. The trainer publishes a
+// fresh snapshot whenever it likes; workers holding an older one keep using
+// it until they next look, so publishing never waits for a search to finish.
+class WeightPublisher {
+ public:
+  // Copies the model's current weights into a new snapshot and makes it the
+  // latest. Returns its version. Only one thread may publish.
+  uint64_t Publish(const torch::nn::Module& model);
+
+  // The version of the latest snapshot, zero before the first. Cheap enough
+  // to check between every search.
+  uint64_t GetVersion() const {
+    return version_.load(std::memory_order_acquire);
+  }
+  std::shared_ptr<const WeightSnapshot> GetLatest() const {
+    return std::atomic_load(&latest_);
+  }
+
+ private:
+  std::shared_ptr<const WeightSnapshot> latest_;
+  std::atomic<uint64_t> version_{0};
+};
+
+// Keeps a worker's own copy of a model in step with a publisher. The model
+// must have the same architecture as the published one.
+class WeightSubscriber {
+ public:
+  WeightSubscriber(const WeightPublisher& publisher, torch::nn::Module& model)
+      : publisher_(publisher), model_(model) {}
+
+  // Loads the latest snapshot into the model unless it already holds it.
+  // Returns true if the weights changed.
+  bool Refresh();
+  // The version of the weights the model holds, zero if none were loaded
+  uint64_t GetVersion() const { return version_; }
+
+ private:
+  const WeightPublisher& publisher_;
+  torch::nn::Module& model_;
+  uint64_t version_ = 0;
+};
+
+#endif /* WEIGHT_PUBLISHER_H */
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <arena.h>
+
+#include "mock_evaluator.h"
+
+TEST(ArenaTests, RandomPlayerPlaysLegalMoves) {
+  auto game = Connect2Game();
+  RandomPlayer player(game, /*seed=*/1);
+  std::vector<int> board = {1, 0, -1, 0};
+
+  for (int i = 0; i < 20; ++i) {
+    auto action = player.SelectMove(board);
+    ASSERT_TRUE(action == 1 || action == 3);
+  }
+}
+
+TEST(ArenaTests, MinimaxTakesTheWin) {
+  auto game = Connect2Game();
+  MinimaxPlayer player(game, /*depth=*/1, /*seed=*/1);
+  std::vector<int> board = {0, 0, 1, -1};
+
+  ASSERT_EQ(player.SelectMove(board), 1);
+}
+
+TEST(ArenaTests, MinimaxBlocksTheLoss) {
+  auto game = Connect2Game();
+  MinimaxPlayer player(game, /*depth=*/2, /*seed=*/1);
+  std::vector<int> board = {-1, 0, 0, 0};
+
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(player.SelectMove(board), 1);
+  }
+}
+
+TEST(ArenaTests, MinimaxWinsConnect2WhenMovingFirst) {
+  auto game = Connect2Game();
+  for (uint32_t seed = 0; seed < 10; ++seed) {
+    MinimaxPlayer player(game, /*depth=*/3, seed);
+    RandomPlayer opponent(game, seed);
+
+    auto result = PlayMatch(game, player, opponent, /*num_games=*/1);
+    ASSERT_EQ(result.wins, 1);
+  }
+}
+
+TEST(ArenaTests, PlayMatchCountsEveryGame) {
+  auto game = Connect2Game();
+  RandomPlayer player(game, /*seed=*/1);
+  RandomPlayer opponent(game, /*seed=*/2);
+
+  auto result = PlayMatch(game, player, opponent, /*num_games=*/9);
+
+  ASSERT_EQ(result.GetNumGames(), 9);
+  ASSERT_GE(result.GetScore(), 0);
+  ASSERT_LE(result.GetScore(), 1);
+}
+
+TEST(ArenaTests, MatchScoreCountsHalfADraw) {
+  MatchResult result;
+  result.wins = 1;
+  result.draws = 2;
+  result.losses = 1;
+
+  ASSERT_EQ(result.GetNumGames(), 4);
+  ASSERT_FLOAT_EQ(result.GetScore(), 0.5);
+}
+
+TEST(ArenaTests, MCTSPlayerFindsTheWin) {
+  auto game = Connect2Game();
+  auto model = GetUniformMockModel(game.GetBoardSize(), game.GetActionSize());
+  MCTSPlayer player(game, model, /*num_simulations=*/50);
+  std::vector<int> board = {0, 0, 1, -1};
+
+  ASSERT_EQ(player.SelectMove(board), 1);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <example.h>
+
+namespace {
+
+Example MakeExample(std::vector<int> board, std::vector<float> action_probs,
+                    float reward, uint64_t weight_version = 0) {
+  return {std::move(board), 1, std::move(action_probs), reward,
+          weight_version};
+}
+
+}  // namespace
+
+TEST(ExampleTests, MergingAveragesTheTargets) {
+  std::vector<Example> examples = {
+      MakeExample({1, 0, 0, 0}, {0, 1, 0, 0}, 1, 3),
+      MakeExample({0, 0, 0, 0}, {0.25, 0.25, 0.25, 0.25}, 0),
+      MakeExample({1, 0, 0, 0}, {0, 0, 1, 0}, -1, 5),
+      MakeExample({1, 0, 0, 0}, {0, 0, 1, 0}, 1, 4),
+  };
+
+  auto merged = MergeDuplicateExamples(examples);
+
+  ASSERT_EQ(merged.size(), 2u);
+  auto& repeated = merged[0].canonical_board[0] == 1 ? merged[0] : merged[1];
+  ASSERT_FLOAT_EQ(repeated.weight, 3);
+  ASSERT_FLOAT_EQ(repeated.reward, 1.0 / 3);
+  ASSERT_FLOAT_EQ(repeated.action_probs[0], 0);
+  ASSERT_FLOAT_EQ(repeated.action_probs[1], 1.0 / 3);
+  ASSERT_FLOAT_EQ(repeated.action_probs[2], 2.0 / 3);
+  ASSERT_EQ(repeated.weight_version, 5u);
+}
+
+TEST(ExampleTests, MergingKeepsTheTotalWeight) {
+  std::vector<Example> examples;
+  for (int i = 0; i < 100; ++i) {
+    examples.push_back(MakeExample({i % 7, 0, i % 3, 0}, {1, 0, 0, 0}, 0));
+  }
+  examples[10].weight = 2;
+
+  auto merged = MergeDuplicateExamples(examples);
+
+  ASSERT_EQ(merged.size(), 21u);
+  float total_weight = 0;
+  for (const auto& example : merged) {
+    total_weight += example.weight;
+  }
+  ASSERT_FLOAT_EQ(total_weight, 101);
+}
+
+TEST(ExampleTests, ParallelMergingMatchesSerialMerging) {
+  std::vector<Example> examples;
+  for (int i = 0; i < 500; ++i) {
+    examples.push_back(MakeExample({i % 11, i % 5, 0, 1},
+                                   {i % 2 * 1.0f, 0, 0, 0},
+                                   static_cast<float>(i % 3 - 1)));
+  }
+
+  auto serial = MergeDuplicateExamples(examples, /*num_threads=*/1);
+  auto parallel = MergeDuplicateExamples(examples, /*num_threads=*/4);
+
+  ASSERT_EQ(serial.size(), parallel.size());
+  auto by_board = [](const Example& a, const Example& b) {
+    return a.canonical_board < b.canonical_board;
+  };
+  std::sort(serial.begin(), serial.end(), by_board);
+  std::sort(parallel.begin(), parallel.end(), by_board);
+  for (size_t i = 0; i < serial.size(); ++i) {
+    ASSERT_EQ(serial[i].canonical_board, parallel[i].canonical_board);
+    ASSERT_FLOAT_EQ(serial[i].weight, parallel[i].weight);
+    ASSERT_FLOAT_EQ(serial[i].reward, parallel[i].reward);
+    ASSERT_FLOAT_EQ(serial[i].action_probs[0], parallel[i].action_probs[0]);
+  }
+}
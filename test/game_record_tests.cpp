@@ -0,0 +1,164 @@
+#include <game.h>
+#include <game_record.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+GameRecord GetConnect2Record() {
+  // The first player takes the two inner cells
+  GameRecord record;
+  record.action_size = 4;
+  record.moves = {1, 0, 2};
+  record.visit_counts = {{10, 30, 30, 10}, {5, 0, 5, 0}, {0, 0, 4, 0}};
+  record.result = 1;
+  return record;
+}
+
+TEST(GameRecordTests, RoundTripsThroughChunks) {
+  auto path = testing::TempDir() + "game_records_round_trip.bin";
+  std::remove(path.c_str());
+  {
+    GameRecordWriter writer(path, /*games_per_chunk=*/2);
+    for (int i = 0; i < 5; ++i) {
+      auto record = GetConnect2Record();
+      record.result = i % 2;
+      writer.Add(record);
+    }
+  }
+
+  GameRecordReader reader(path);
+  GameRecord record;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.action_size, 4);
+    ASSERT_EQ(record.moves, GetConnect2Record().moves);
+    ASSERT_EQ(record.visit_counts, GetConnect2Record().visit_counts);
+    ASSERT_EQ(record.result, i % 2);
+  }
+  ASSERT_FALSE(reader.Next(record));
+
+  std::remove(path.c_str());
+}
+
+TEST(GameRecordTests, AppendsToExistingFiles) {
+  auto path = testing::TempDir() + "game_records_append.bin";
+  std::remove(path.c_str());
+  for (int i = 0; i < 2; ++i) {
+    GameRecordWriter writer(path);
+    writer.Add(GetConnect2Record());
+  }
+
+  GameRecordReader reader(path);
+  GameRecord record;
+  ASSERT_TRUE(reader.Next(record));
+  ASSERT_TRUE(reader.Next(record));
+  ASSERT_FALSE(reader.Next(record));
+
+  std::remove(path.c_str());
+}
+
+TEST(GameRecordTests, IgnoresTruncatedChunk) {
+  auto path = testing::TempDir() + "game_records_truncated.bin";
+  std::remove(path.c_str());
+  {
+    GameRecordWriter writer(path, /*games_per_chunk=*/1);
+    writer.Add(GetConnect2Record());
+    writer.Add(GetConnect2Record());
+  }
+  {
+    // Chop the end off the second chunk
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    auto size = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+    std::string contents(size - 4, '\0');
+    in.read(&contents[0], contents.size());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents;
+  }
+
+  GameRecordReader reader(path);
+  GameRecord record;
+  ASSERT_TRUE(reader.Next(record));
+  ASSERT_FALSE(reader.Next(record));
+
+  std::remove(path.c_str());
+}
+
+TEST(GameRecordTests, ChecksChunkSizesBeforeAllocating) {
+  auto path = testing::TempDir() + "game_records_corrupt.bin";
+  auto write_with = [&](size_t field_offset, uint64_t size) {
+    std::remove(path.c_str());
+    {
+      GameRecordWriter writer(path);
+      writer.Add(GetConnect2Record());
+    }
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(field_offset);
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  };
+  GameRecord record;
+
+  write_with(offsetof(GameRecordChunkHeader, raw_size), uint64_t{1} << 40);
+  {
+    GameRecordReader reader(path);
+    ASSERT_THROW(reader.Next(record), std::runtime_error);
+  }
+  // More compressed bytes than the file has left reads as a truncated chunk
+  write_with(offsetof(GameRecordChunkHeader, compressed_size),
+             uint64_t{1} << 40);
+  {
+    GameRecordReader reader(path);
+    ASSERT_FALSE(reader.Next(record));
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST(GameRecordTests, RegeneratesExamples) {
+  Connect2Game game;
+  std::vector<Example> examples;
+  AppendExamples(game, GetConnect2Record(), examples);
+
+  ASSERT_EQ(examples.size(), 3u);
+
+  ASSERT_EQ(examples[0].canonical_board, std::vector<int>({0, 0, 0, 0}));
+  ASSERT_EQ(examples[0].current_player, 1);
+  ASSERT_EQ(examples[0].reward, 1);
+  ASSERT_NEAR(examples[0].action_probs[1], 0.375, 1e-6);
+
+  // Seen from the second player's perspective
+  ASSERT_EQ(examples[1].canonical_board, std::vector<int>({0, -1, 0, 0}));
+  ASSERT_EQ(examples[1].current_player, -1);
+  ASSERT_EQ(examples[1].reward, -1);
+  ASSERT_NEAR(examples[1].action_probs[0], 0.5, 1e-6);
+
+  ASSERT_EQ(examples[2].canonical_board, std::vector<int>({-1, 1, 0, 0}));
+  ASSERT_EQ(examples[2].reward, 1);
+  ASSERT_NEAR(examples[2].action_probs[2], 1, 1e-6);
+}
+
+TEST(GameRecordTests, RejectsRecordsOfOtherGames) {
+  Connect2Game game;
+  std::vector<Example> examples;
+
+  auto record = GetConnect2Record();
+  record.action_size = 7;
+  for (auto& counts : record.visit_counts) {
+    counts.resize(7);
+  }
+  ASSERT_THROW(AppendExamples(game, record, examples), std::runtime_error);
+
+  record = GetConnect2Record();
+  record.moves[1] = 6;
+  ASSERT_THROW(AppendExamples(game, record, examples), std::runtime_error);
+}
+
+TEST(GameRecordTests, QuantizesLargeVisitCounts) {
+  ASSERT_EQ(QuantizeVisitCounts({0, 3, 800}),
+            std::vector<uint16_t>({0, 3, 800}));
+  ASSERT_EQ(QuantizeVisitCounts({0, 65535, 131070}),
+            std::vector<uint16_t>({0, 32768, 65535}));
+}
@@ -35,6 +35,27 @@ TEST(Connect2Tests, GetNextStateWorks) {
   ASSERT_EQ(nextState.player, -1);
 }
 
+TEST(Connect2Tests, PlayMoveWorks) {
+  Connect2Game game;
+  std::vector<int> board = {0, 0, -1, 0};
+  game.PlayMove(board, /*player=*/1, /*action=*/3);
+
+  // PlayMove should agree with GetNextState
+  ASSERT_EQ(board, game.GetNextState({0, 0, -1, 0}, 1, 3).board);
+  ASSERT_EQ(board[3], 1);
+}
+
+TEST(Connect2Tests, MakeCanonicalWorks) {
+  Connect2Game game;
+  std::vector<int> board = {1, 0, -1, 0};
+  game.MakeCanonical(board, /*player=*/-1);
+
+  // MakeCanonical should agree with GetCanonicalBoard
+  ASSERT_EQ(board, game.GetCanonicalBoard({1, 0, -1, 0}, -1));
+  ASSERT_EQ(board[0], -1);
+  ASSERT_EQ(board[2], 1);
+}
+
 TEST(Connect2Tests, GetValidMovesWorks) {
   Connect2Game game;
   std::vector<int> original_board = {0, 0, -1, 0};
@@ -274,4 +295,97 @@ TEST(Connect2Tests, GetCanonicalBoard_TogglePointOfView) {
   ASSERT_EQ(next_board[1], 0);
   ASSERT_EQ(next_board[2], 0);
   ASSERT_EQ(next_board[3], 0);
-}
\ No newline at end of file
+}
+
+TEST(Connect2Tests, GetCanonicalBoard_PlayerOneKeepsBoard) {
+  Connect2Game game;
+  std::vector<int> original_board = {1, -1, 0, 0};
+
+  auto next_board = game.GetCanonicalBoard(original_board, /*player=*/1);
+
+  ASSERT_EQ(next_board, original_board);
+}
+
+TEST(FixedConnect4Tests, PiecesFallToTheBottom) {
+  auto board = FixedConnect4Game::GetInitBoard();
+
+  FixedConnect4Game::PlayMove(board, /*player=*/1, /*action=*/3);
+  FixedConnect4Game::PlayMove(board, /*player=*/-1, /*action=*/3);
+
+  ASSERT_EQ(board[5 * 7 + 3], 1);
+  ASSERT_EQ(board[4 * 7 + 3], -1);
+  ASSERT_EQ(board[3 * 7 + 3], 0);
+}
+
+TEST(FixedConnect4Tests, FullColumnIsNotValid) {
+  auto board = FixedConnect4Game::GetInitBoard();
+  for (int i = 0; i < 6; ++i) {
+    board = FixedConnect4Game::GetNextState(board, i % 2 ? -1 : 1, 0).board;
+  }
+
+  auto valid_moves = FixedConnect4Game::GetValidMoves(board);
+
+  ASSERT_EQ(valid_moves[0], 0);
+  for (int column = 1; column < 7; ++column) {
+    ASSERT_EQ(valid_moves[column], 1);
+  }
+}
+
+TEST(FixedConnect4Tests, DetectsWinsInEveryDirection) {
+  std::vector<std::vector<int>> lines = {
+      {35, 36, 37, 38},  // horizontal along the bottom row
+      {6, 13, 20, 27},   // vertical in the last column
+      {14, 22, 30, 38},  // diagonal down and to the right
+      {17, 23, 29, 35},  // diagonal down and to the left
+  };
+
+  for (auto& line : lines) {
+    FixedConnect4Game::Board board{};
+    for (auto cell : line) {
+      board[cell] = -1;
+    }
+
+    ASSERT_TRUE(FixedConnect4Game::IsWin(board, -1));
+    ASSERT_FALSE(FixedConnect4Game::IsWin(board, 1));
+    ASSERT_EQ(FixedConnect4Game::GetRewardForPlayer(board, 1), -1);
+
+    // Three in a row is not enough
+    board[line[0]] = 0;
+    ASSERT_FALSE(FixedConnect4Game::IsWin(board, -1));
+  }
+}
+
+TEST(FixedConnect4Tests, DoesNotWrapAroundEdges) {
+  FixedConnect4Game::Board board{};
+  // The end of one row and the start of the next
+  board[5] = board[6] = board[7] = board[8] = 1;
+
+  ASSERT_FALSE(FixedConnect4Game::IsWin(board, 1));
+  ASSERT_EQ(FixedConnect4Game::GetRewardForPlayer(board, 1), std::nullopt);
+}
+
+TEST(FixedConnect4Tests, AdapterMatchesFixedGame) {
+  ConnectXGameAdapter<FixedConnect4Game> game;
+  auto fixed_board = FixedConnect4Game::GetInitBoard();
+  auto board = game.GetInitBoard();
+
+  for (int action : {3, 3, 4, 2, 5, 6}) {
+    fixed_board = FixedConnect4Game::GetNextState(fixed_board, 1, action).board;
+    board = game.GetNextState(board, 1, action).board;
+    fixed_board = FixedConnect4Game::GetCanonicalBoard(fixed_board, -1);
+    game.MakeCanonical(board, -1);
+
+    ASSERT_TRUE(std::equal(board.begin(), board.end(), fixed_board.begin()));
+    ASSERT_EQ(game.GetRewardForPlayer(board, 1),
+              FixedConnect4Game::GetRewardForPlayer(fixed_board, 1));
+  }
+}
+
+TEST(FixedConnect4Tests, MakesCompiledInConfigurations) {
+  auto game = MakeConnectXGame(/*rows=*/6, /*columns=*/7, /*num_to_win=*/4);
+  ASSERT_EQ(game->GetInitBoard().size(), 42u);
+  ASSERT_EQ(game->GetValidMoves(game->GetInitBoard()).size(), 7u);
+
+  ASSERT_THROW(MakeConnectXGame(/*rows=*/3, /*columns=*/3, /*num_to_win=*/3),
+               std::invalid_argument);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <mapped_model.h>
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+TEST(MappedModelTests, DenseLayerMatchesScalar) {
+  // Rows that leave a remainder after the vector loop, and aligned rows that
+  // take the aligned loads
+  for (auto [num_inputs, num_outputs] : {std::pair<int, int>{11, 5},
+                                         std::pair<int, int>{8, 3}}) {
+    alignas(16) float weights[64];
+    std::vector<float> bias(num_outputs), input(num_inputs);
+    for (int i = 0; i < num_inputs * num_outputs; ++i) {
+      weights[i] = std::sin(i * 0.7f);
+    }
+    for (int i = 0; i < num_outputs; ++i) {
+      bias[i] = 0.1f * i;
+    }
+    for (int i = 0; i < num_inputs; ++i) {
+      input[i] = i % 3 - 1;
+    }
+
+    std::vector<float> expected(num_outputs), actual(num_outputs);
+    DenseLayerScalar(weights, bias.data(), input.data(), num_inputs,
+                     num_outputs, expected.data());
+    DenseLayer(weights, bias.data(), input.data(), num_inputs, num_outputs,
+               actual.data());
+    for (int i = 0; i < num_outputs; ++i) {
+      ASSERT_NEAR(actual[i], expected[i], 1e-5);
+    }
+  }
+}
+
+// A network with two hidden units, small enough to evaluate by hand
+void WriteTinyConnect2Weights(const std::string& path) {
+  WriteWeightFile(path, {{"fc1.weight", {2, 4}, {1, 0, 0, 0, 0, 1, 0, 0}},
+                         {"fc1.bias", {2}, {0, 0}},
+                         {"fc2.weight", {2, 2}, {1, 0, 0, 1}},
+                         {"fc2.bias", {2}, {0, 0.5}},
+                         {"action_head.weight", {4, 2}, {1, 0, 0, 1, 1, 1, 0, 0}},
+                         {"action_head.bias", {4}, {0, 0, 0, -1}},
+                         {"value_head.weight", {1, 2}, {1, -1}},
+                         {"value_head.bias", {1}, {0}}});
+}
+
+TEST(MappedModelTests, EvaluatesMappedWeights) {
+  auto path = testing::TempDir() + "mapped_model_tiny.bin";
+  WriteTinyConnect2Weights(path);
+  MappedConnect2Model model(path, /*board_size=*/4, /*action_size=*/4);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(model.GetHiddenSize(), 2);
+  std::vector<int> boards = {1, 1, 0, 0, -1, 0, 0, 0};
+  auto batch = model.predict_batch(boards.data(), /*batch_size=*/2);
+
+  std::vector<float> expected_logits = {1, 1.5, 2.5, -1, 0, 0.5, 0.5, -1};
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_NEAR(batch.action_logits[i], expected_logits[i], 1e-6);
+  }
+  // The relu clips the first unit of the second board
+  ASSERT_NEAR(batch.values[0], std::tanh(-0.5), 1e-6);
+  ASSERT_NEAR(batch.values[1], std::tanh(-0.5), 1e-6);
+
+  std::vector<int> board = {1, 1, 0, 0};
+  auto prediction = model.predict(board);
+  float sum = 0;
+  for (auto prob : prediction.action_probs) {
+    sum += prob;
+  }
+  ASSERT_NEAR(sum, 1, 1e-6);
+  ASSERT_GT(prediction.action_probs[2], prediction.action_probs[1]);
+}
+
+TEST(MappedModelTests, RejectsWeightsOfAnotherShape) {
+  auto path = testing::TempDir() + "mapped_model_shape.bin";
+  WriteTinyConnect2Weights(path);
+
+  ASSERT_THROW(MappedConnect2Model(path, /*board_size=*/42, /*action_size=*/7),
+               std::runtime_error);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <masked_softmax.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+TEST(MaskedSoftmaxTests, BuildsMaskFromValidMoves) {
+  ASSERT_EQ(GetLegalMoveMask(std::vector<int>({1, 0, 1, 1})), 0b1101u);
+  ASSERT_EQ(GetLegalMoveMask(std::vector<int>({0, 0, 0})), 0u);
+}
+
+TEST(MaskedSoftmaxTests, NormalizesOverLegalMovesOnly) {
+  float logits[4] = {0, 100, 0, std::log(3.0f)};
+  int actions[3];
+  float priors[3];
+
+  auto count = MaskedSoftmax(logits, /*legal_moves=*/0b1101, actions, priors);
+
+  ASSERT_EQ(count, 3);
+  ASSERT_EQ(actions[0], 0);
+  ASSERT_EQ(actions[1], 2);
+  ASSERT_EQ(actions[2], 3);
+  ASSERT_NEAR(priors[0], 0.2, 1e-6);
+  ASSERT_NEAR(priors[1], 0.2, 1e-6);
+  ASSERT_NEAR(priors[2], 0.6, 1e-6);
+}
+
+TEST(MaskedSoftmaxTests, StableForLargeLogits) {
+  float logits[2] = {1000, 1000 + std::log(3.0f)};
+  int actions[2];
+  float priors[2];
+
+  ASSERT_EQ(MaskedSoftmax(logits, 0b11, actions, priors), 2);
+  // Float logits near 1000 are only accurate to about 1e-4
+  ASSERT_NEAR(priors[0], 0.25, 1e-4);
+  ASSERT_NEAR(priors[1], 0.75, 1e-4);
+}
+
+TEST(MaskedSoftmaxTests, SkipsNegativeInfinityAndEmptyMasks) {
+  const float kInf = std::numeric_limits<float>::infinity();
+  float logits[3] = {-kInf, 1, -kInf};
+  int actions[3];
+  float priors[3];
+
+  ASSERT_EQ(MaskedSoftmax(logits, 0b111, actions, priors), 1);
+  ASSERT_EQ(actions[0], 1);
+  ASSERT_NEAR(priors[0], 1, 1e-6);
+
+  ASSERT_EQ(MaskedSoftmax(logits, 0b101, actions, priors), 0);
+  ASSERT_EQ(MaskedSoftmax(logits, 0, actions, priors), 0);
+}
+
+TEST(MaskedSoftmaxTests, MatchesScalarReference) {
+  std::mt19937 generator(7);
+  std::normal_distribution<float> logit_distr(0, 5);
+
+  for (int num_actions = 1; num_actions <= 64; ++num_actions) {
+    std::vector<float> logits(num_actions);
+    for (auto& logit : logits) {
+      logit = logit_distr(generator);
+    }
+    uint64_t legal_moves = generator() | (uint64_t(generator()) << 32);
+    if (num_actions < 64) {
+      legal_moves &= (uint64_t(1) << num_actions) - 1;
+    }
+
+    int actions[64], expected_actions[64];
+    float priors[64], expected_priors[64];
+    auto count = MaskedSoftmax(logits.data(), legal_moves, actions, priors);
+    auto expected_count = MaskedSoftmaxScalar(
+        logits.data(), legal_moves, expected_actions, expected_priors);
+
+    ASSERT_EQ(count, expected_count);
+    for (int i = 0; i < count; ++i) {
+      ASSERT_EQ(actions[i], expected_actions[i]);
+      ASSERT_NEAR(priors[i], expected_priors[i], 1e-6);
+    }
+  }
+}
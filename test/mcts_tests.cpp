@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 #include <monte_carlo_tree_search.h>
 
+#include <memory>
+#include <thread>
+
+#include "mock_evaluator.h"
+
 TEST(MCTSTests, NodeConstructorWorks) {
   int prior = 0.5;
   int toPlay = 1;
@@ -17,9 +22,8 @@ TEST(MCTSTests, NodeCanExpandCorrectly) {
   int action = 0;
   Node node(prior, toPlay, action);
 
-  std::vector<int> state = {0, 0, 0, 0};
   std::vector<float> actionProbs = {0.25, 0.25, 0.25, 0.25};
-  node.Expand(state, toPlay, actionProbs);
+  node.Expand(toPlay, actionProbs);
 
   ASSERT_EQ(node.IsExpanded(), true);
 }
@@ -192,36 +196,36 @@ TEST(MCTSTests, Backup_TwoNodes_PositiveValue) {
   ASSERT_EQ(node2.GetVisitCount(), 1);
 }
 
-struct Connect2MockModel : Model {
-  std::vector<float> action_probs;
-  float value;
-
-  Connect2MockModel(int board_size, int action_size, 
-                    std::vector<float> action_probs, float value)
-    : Model(board_size, action_size), action_probs(action_probs), value(value) 
-    {}
+TEST(MCTSTests, EvaluatorsSharingAThreadKeepTheirPredictions) {
+  auto first = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.5);
+  auto second = GetMockModel({0.25, 0.25, 0.25, 0.25}, -0.5);
+  std::vector<int> board = {0, 0, 0, 0};
 
-  ActionProbsAndValueTensor forward(const torch::Tensor& input) override {
-    throw "forward() is not mocked.";
-  }
-
-  ActionProbsAndValue predict(std::vector<int>& board) override {
-    return {action_probs, value};
-  }
-};
+  auto first_prediction = first.predict_batch(board.data(), 1);
+  auto second_prediction = second.predict_batch(board.data(), 1);
 
-Connect2MockModel GetMockModel(std::vector<float> action_probs, float value) {
-
-  int board_size = 4;
-  int action_size = 4;
+  ASSERT_FLOAT_EQ(first_prediction.values[0], 0.5);
+  ASSERT_FLOAT_EQ(second_prediction.values[0], -0.5);
+}
 
-  Connect2MockModel model(board_size, action_size, action_probs, value);
-  return model;
+TEST(MCTSTests, ThreadBuffersBelongToTheirOwnerAndThread) {
+  auto buffers = std::make_unique<ThreadBuffers<std::vector<int>>>();
+  buffers->Get().push_back(1);
+  ASSERT_EQ(&buffers->Get(), &buffers->Get());
+  ASSERT_EQ(buffers->Get().size(), 1u);
+
+  std::vector<int>* other_thread_buffers = nullptr;
+  std::thread([&] { other_thread_buffers = &buffers->Get(); }).join();
+  ASSERT_NE(other_thread_buffers, &buffers->Get());
+  ASSERT_TRUE(other_thread_buffers->empty());
+
+  // An owner created where another was destroyed starts afresh
+  buffers.reset();
+  buffers = std::make_unique<ThreadBuffers<std::vector<int>>>();
+  ASSERT_TRUE(buffers->Get().empty());
 }
 
 TEST(MCTSTests, RootWithEqualPriors) {
-  int board_size = 4;
-  int action_size = 4;
   auto game = Connect2Game();
   std::vector<float> action_probs = {0.26, 0.24, 0.24, 0.26};
   float value = 0.0001;
@@ -239,8 +243,6 @@ TEST(MCTSTests, RootWithEqualPriors) {
 }
 
 TEST(MCTSTests, MCTSFindsBestMoveWithGoodPriors) {
-  int board_size = 4;
-  int action_size = 4;
   auto game = Connect2Game();
   std::vector<float> action_probs = {0.3, 0.7, 0.0, 0.0};
   float value = 0.0001;
@@ -257,8 +259,6 @@ TEST(MCTSTests, MCTSFindsBestMoveWithGoodPriors) {
 }
 
 TEST(MCTSTests, MCTSFindsBestMoveWithBadPriors) {
-  int board_size = 4;
-  int action_size = 4;
   auto game = Connect2Game();
   std::vector<float> action_probs = {0.7, 0.3, 0.0, 0.0};
   float value = 0.0001;
@@ -275,8 +275,6 @@ TEST(MCTSTests, MCTSFindsBestMoveWithBadPriors) {
 }
 
 TEST(MCTSTests, MCTSFindsBestMoveWithEqualPriors) {
-  int board_size = 4;
-  int action_size = 4;
   auto game = Connect2Game();
   std::vector<float> action_probs = {0.51, 0.49, 0.0, 0.0};
   float value = 0.0001;
@@ -293,8 +291,6 @@ TEST(MCTSTests, MCTSFindsBestMoveWithEqualPriors) {
 }
 
 TEST(MCTSTests, MCTSFindsBestMoveWithEqualPriors2) {
-  int board_size = 4;
-  int action_size = 4;
   auto game = Connect2Game();
   std::vector<float> action_probs = {0.1, 0.3, 0.3, 0.3};
   float value = 0.0001;
@@ -313,8 +309,6 @@ TEST(MCTSTests, MCTSFindsBestMoveWithEqualPriors2) {
 }
 
 TEST(MCTSTests, MCTSBlocksPlayer) {
-  int board_size = 4;
-  int action_size = 4;
   auto game = Connect2Game();
   std::vector<float> action_probs = {0.25, 0.25, 0.25, 0.25};
   float value = 0.0001;
@@ -330,4 +324,398 @@ TEST(MCTSTests, MCTSBlocksPlayer) {
 
   ASSERT_LT(pos_0_count, pos_1_count);
   ASSERT_LT(pos_0_count, pos_3_count);
-}
\ No newline at end of file
+}
+
+TEST(MCTSTests, Backup_ProvenLossForChildSolvesParent) {
+  Node root(0, /*toPlay=*/1, /*action=*/-1);
+  root.Expand(/*to_play=*/1, {0.5, 0.5, 0.0, 0.0});
+  Node* child = root.GetChildByAction(1);
+  child->SetProvenValue(ProvenValue::kLoss);
+
+  MCTS::Backup({&root, child}, /*value=*/-1, /*to_play=*/-1);
+
+  ASSERT_EQ(root.GetProvenValue(), ProvenValue::kWin);
+  ASSERT_EQ(root.SelectAction(/*temperature=*/0), 1);
+}
+
+TEST(MCTSTests, Backup_ParentStaysOpenWhileAChildIsUnproven) {
+  Node root(0, /*toPlay=*/1, /*action=*/-1);
+  root.Expand(/*to_play=*/1, {0.5, 0.5, 0.0, 0.0});
+  Node* child = root.GetChildByAction(0);
+  child->SetProvenValue(ProvenValue::kWin);
+
+  MCTS::Backup({&root, child}, /*value=*/1, /*to_play=*/-1);
+
+  ASSERT_FALSE(root.IsProven());
+  // The solved child must not be selected again
+  ASSERT_EQ(root.SelectChild(/*c_puct=*/1.0)->GetAction(), 1);
+}
+
+TEST(MCTSTests, SolverFindsForcedWinAndStopsEarly) {
+  auto game = Connect2Game();
+  // Priors favour the move that doesn't win
+  auto model = GetMockModel({0.7, 0.3, 0.0, 0.0}, 0.0001);
+  std::vector<int> state = {0, 0, 1, -1};
+  MCTSOptions options;
+  options.use_solver = true;
+  auto mcts = MCTS(game, model, options);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(state, /*to_play=*/1, /*num_simulations=*/100));
+
+  ASSERT_EQ(root->GetProvenValue(), ProvenValue::kWin);
+  ASSERT_EQ(root->SelectAction(/*temperature=*/0), 1);
+  ASSERT_LT(root->GetVisitCount(), 100);
+}
+
+TEST(MCTSTests, SolverFindsForcedLoss) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  // Wherever we play, the opponent can complete a pair next to their piece
+  std::vector<int> state = {0, -1, 0, 0};
+  MCTSOptions options;
+  options.use_solver = true;
+  auto mcts = MCTS(game, model, options);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(state, /*to_play=*/1, /*num_simulations=*/100));
+
+  ASSERT_EQ(root->GetProvenValue(), ProvenValue::kLoss);
+  ASSERT_LT(root->GetVisitCount(), 100);
+}
+
+TEST(MCTSTests, SolverFindsForcedDraw) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  // Playing 2 draws, playing 3 lets the opponent win
+  std::vector<int> state = {1, -1, 0, 0};
+  MCTSOptions options;
+  options.use_solver = true;
+  auto mcts = MCTS(game, model, options);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(state, /*to_play=*/1, /*num_simulations=*/100));
+
+  ASSERT_EQ(root->GetProvenValue(), ProvenValue::kDraw);
+  ASSERT_EQ(root->GetChildByAction(3)->GetProvenValue(), ProvenValue::kWin);
+  ASSERT_EQ(root->SelectAction(/*temperature=*/0), 2);
+  ASSERT_LT(root->GetVisitCount(), 100);
+}
+
+TEST(MCTSTests, SelectActionAvoidsChildrenProvenLost) {
+  Node root(0, /*toPlay=*/1, /*action=*/-1);
+  root.Expand(/*to_play=*/1, {0.5, 0.5, 0.0, 0.0});
+  // The most visited child turned out to be a win for the opponent
+  for (int i = 0; i < 10; ++i) {
+    root.RecordChildVisit(/*child_index=*/0, /*val=*/-0.5);
+  }
+  root.RecordChildVisit(/*child_index=*/1, /*val=*/0);
+  root.GetChildByAction(0)->SetProvenValue(ProvenValue::kWin);
+
+  ASSERT_FALSE(root.IsProven());
+  ASSERT_EQ(root.SelectAction(/*temperature=*/0), 1);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(root.SelectAction(/*temperature=*/1), 1);
+  }
+}
+
+TEST(MCTSTests, FullBudgetIsUsedByDefault) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  std::vector<int> state = {0, 0, 0, 0};
+  auto mcts = MCTS(game, model);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(state, /*to_play=*/1, /*num_simulations=*/50));
+
+  ASSERT_EQ(mcts.GetStats().simulations, 50);
+  ASSERT_EQ(mcts.GetStats().simulations_saved, 0);
+}
+
+TEST(MCTSTests, ForcedMoveStopsAfterMinimumBudget) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  // Only the last cell is free
+  std::vector<int> state = {1, -1, 1, 0};
+  auto mcts = MCTS(game, model);
+
+  auto root = std::unique_ptr<Node>(mcts.Run(
+      state, /*to_play=*/1, /*min_simulations=*/5, /*max_simulations=*/100));
+
+  ASSERT_EQ(root->SelectAction(/*temperature=*/0), 3);
+  ASSERT_EQ(mcts.GetStats().searches, 1);
+  ASSERT_EQ(mcts.GetStats().simulations, 5);
+  ASSERT_EQ(mcts.GetStats().simulations_saved, 95);
+}
+
+TEST(MCTSTests, EarlyStoppingKeepsTheBestMove) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.1, 0.3, 0.3, 0.3}, 0.0001);
+  std::vector<int> state = {-1, 0, 0, 0};
+
+  auto full_mcts = MCTS(game, model);
+  auto full_root = std::unique_ptr<Node>(
+      full_mcts.Run(state, /*to_play=*/1, /*num_simulations=*/200));
+
+  auto adaptive_mcts = MCTS(game, model);
+  auto adaptive_root = std::unique_ptr<Node>(adaptive_mcts.Run(
+      state, /*to_play=*/1, /*min_simulations=*/0, /*max_simulations=*/200));
+
+  ASSERT_EQ(adaptive_root->SelectAction(/*temperature=*/0),
+            full_root->SelectAction(/*temperature=*/0));
+  ASSERT_GT(adaptive_mcts.GetStats().simulations_saved, 0);
+  ASSERT_EQ(adaptive_mcts.GetStats().simulations +
+                adaptive_mcts.GetStats().simulations_saved,
+            200);
+}
+
+TEST(MCTSTests, FixedGameSearchMatchesVirtualSearch) {
+  auto game = Connect2Game();
+  auto fixed_game = FixedConnect2Game();
+  auto model = GetMockModel({0.1, 0.3, 0.3, 0.3}, 0.0001);
+
+  auto mcts = MCTS(game, model);
+  auto root = std::unique_ptr<Node>(
+      mcts.Run({-1, 0, 0, 0}, /*to_play=*/1, /*num_simulations=*/100));
+
+  auto fixed_mcts = BasicMCTS<FixedConnect2Game>(fixed_game, model);
+  auto fixed_root = std::unique_ptr<Node>(
+      fixed_mcts.Run({-1, 0, 0, 0}, /*to_play=*/1, /*num_simulations=*/100));
+
+  for (int action = 1; action < 4; ++action) {
+    ASSERT_EQ(root->GetChildByAction(action)->GetVisitCount(),
+              fixed_root->GetChildByAction(action)->GetVisitCount());
+  }
+}
+
+TEST(MCTSTests, CollapseKeepsStatisticsAndReexpands) {
+  Node node(0.5, /*toPlay=*/1, /*action=*/0);
+  node.Expand(1, {0.25, 0.25, 0.25, 0.25});
+  node.GetChildByAction(2)->Expand(-1, {0.5, 0.5, 0, 0});
+  node.AccumulateValue(3);
+  node.IncrementVisitCount();
+  auto live_nodes = Node::GetNumLiveNodes();
+
+  ASSERT_EQ(node.CountDescendants(), 6);
+  ASSERT_EQ(node.Collapse(), 6);
+  ASSERT_FALSE(node.IsExpanded());
+  ASSERT_EQ(node.GetVisitCount(), 1);
+  ASSERT_EQ(node.GetValue(), 3);
+  ASSERT_EQ(Node::GetNumLiveNodes(), live_nodes - 6);
+
+  node.Expand(1, {0.5, 0.5, 0, 0});
+  ASSERT_EQ(node.Children.size(), 2u);
+  ASSERT_EQ(node.GetChildByAction(1)->GetVisitCount(), 0);
+}
+
+TEST(MCTSTests, NodeBudgetBoundsTreeSize) {
+  auto game = FixedConnect4Game();
+  Connect2MockModel model(/*board_size=*/42, /*action_size=*/7,
+                          std::vector<float>(7, 1.0 / 7), 0.0001);
+  MCTSOptions options;
+  options.max_nodes = 100;
+  auto mcts = BasicMCTS<FixedConnect4Game>(game, model, options);
+
+  auto root = std::unique_ptr<Node>(mcts.Run(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1,
+      /*num_simulations=*/400));
+
+  // An expansion may overshoot the budget by one node's children
+  ASSERT_LT(1 + root->CountDescendants(), 100 + 7);
+  ASSERT_GT(mcts.GetStats().nodes_pruned, 0);
+  ASSERT_LE(mcts.GetStats().peak_tree_nodes, 100 + 7);
+  // The statistics of collapsed subtrees stay with their parents
+  ASSERT_EQ(root->GetVisitCount(), 400);
+}
+
+TEST(MCTSTests, LiveNodeBudgetIsSharedBetweenSearches) {
+  auto game = FixedConnect4Game();
+  Connect2MockModel model(/*board_size=*/42, /*action_size=*/7,
+                          std::vector<float>(7, 1.0 / 7), 0.0001);
+  auto unlimited = BasicMCTS<FixedConnect4Game>(game, model);
+  auto other_root = std::unique_ptr<Node>(unlimited.Run(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1,
+      /*num_simulations=*/50));
+
+  MCTSOptions options;
+  options.max_live_nodes = Node::GetNumLiveNodes() + 50;
+  auto limited = BasicMCTS<FixedConnect4Game>(game, model, options);
+  auto root = std::unique_ptr<Node>(limited.Run(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1,
+      /*num_simulations=*/200));
+
+  ASSERT_LT(1 + root->CountDescendants(), 50 + 7);
+  ASSERT_GT(limited.GetStats().nodes_pruned, 0);
+}
+
+TEST(MCTSTests, LazyExpansionAllocatesChildrenWhenSelected) {
+  Node node(0.5, /*toPlay=*/1, /*action=*/0);
+  ASSERT_EQ(node.Expand(1, {0.25, 0.25, 0.0, 0.5}, /*lazy=*/true), 0);
+
+  ASSERT_TRUE(node.IsExpanded());
+  ASSERT_EQ(node.GetNumChildren(), 3);
+  ASSERT_EQ(node.CountDescendants(), 0);
+
+  // Unvisited children are scored from their priors alone
+  node.IncrementVisitCount();
+  auto child = node.SelectChild(/*c_puct=*/1.0);
+  ASSERT_EQ(child->GetAction(), 3);
+  ASSERT_EQ(child->GetPlayerId(), -1);
+  ASSERT_TRUE(node.HasChild(2));
+  ASSERT_FALSE(node.HasChild(0));
+  ASSERT_EQ(node.CountDescendants(), 1);
+}
+
+TEST(MCTSTests, LazySearchMatchesEagerSearch) {
+  auto game = FixedConnect4Game();
+  Connect2MockModel model(/*board_size=*/42, /*action_size=*/7,
+                          {0.1, 0.1, 0.2, 0.2, 0.2, 0.1, 0.1}, 0.0001);
+  auto eager = BasicMCTS<FixedConnect4Game>(game, model);
+  auto eager_root = std::unique_ptr<Node>(eager.Run(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1,
+      /*num_simulations=*/300));
+
+  MCTSOptions options;
+  options.lazy_children = true;
+  auto lazy = BasicMCTS<FixedConnect4Game>(game, model, options);
+  auto lazy_root = std::unique_ptr<Node>(lazy.Run(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1,
+      /*num_simulations=*/300));
+
+  for (int i = 0; i < eager_root->GetNumChildren(); ++i) {
+    ASSERT_EQ(eager_root->GetChildAction(i), lazy_root->GetChildAction(i));
+    ASSERT_EQ(eager_root->GetChildVisitCount(i),
+              lazy_root->GetChildVisitCount(i));
+  }
+  // Each simulation allocates at most the one node it reaches
+  ASSERT_LE(lazy.GetStats().nodes_created, 1 + 300);
+  ASSERT_GT(eager.GetStats().nodes_created,
+            3 * lazy.GetStats().nodes_created);
+  ASSERT_EQ(lazy.GetStats().nodes_created, 1 + lazy_root->CountDescendants());
+}
+
+TEST(MCTSTests, ExpandFromLogitsMatchesMaskedProbabilities) {
+  std::vector<float> probs = {0.1, 0.2, 0.3, 0.4};
+  std::vector<float> logits = {std::log(0.1f), std::log(0.2f), std::log(0.3f),
+                               std::log(0.4f)};
+  std::vector<int> valid_moves = {1, 0, 1, 1};
+
+  Node from_probs(0, /*toPlay=*/1, /*action=*/-1);
+  from_probs.Expand(1, MCTS::MaskInvalidMovesAndNormalize(probs, valid_moves));
+  Node from_logits(0, /*toPlay=*/1, /*action=*/-1);
+  from_logits.ExpandFromLogits(1, logits.data(),
+                               GetLegalMoveMask(valid_moves));
+
+  ASSERT_EQ(from_logits.GetNumChildren(), 3);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(from_logits.GetChildAction(i), from_probs.GetChildAction(i));
+  }
+  // The priors show up in which child gets selected first
+  from_probs.IncrementVisitCount();
+  from_logits.IncrementVisitCount();
+  ASSERT_EQ(from_logits.SelectChild(1.0)->GetAction(),
+            from_probs.SelectChild(1.0)->GetAction());
+}
+
+TEST(MCTSTests, DefaultPredictBatchEvaluatesEachBoard) {
+  auto model = GetMockModel({0.1, 0.2, 0.3, 0.4}, 0.5);
+  std::vector<int> boards = {0, 0, 0, 0, 1, -1, 0, 0};
+
+  auto batch = model.predict_batch(boards.data(), /*batch_size=*/2);
+
+  ASSERT_EQ(batch.batch_size, 2);
+  ASSERT_EQ(batch.action_size, 4);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(batch.values[i], 0.5);
+    ASSERT_NEAR(batch.GetActionLogits(i)[3], std::log(0.4f), 1e-6);
+  }
+}
+
+TEST(MCTSTests, DeadlineIsCheckedEveryInterval) {
+  auto game = FixedConnect4Game();
+  Connect2MockModel model(/*board_size=*/42, /*action_size=*/7,
+                          std::vector<float>(7, 1.0 / 7), 0.0001);
+  MCTSOptions options;
+  options.time_check_interval = 4;
+  auto mcts = BasicMCTS<FixedConnect4Game>(game, model, options);
+
+  auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+  auto root = std::unique_ptr<Node>(mcts.RunUntil(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1, deadline));
+
+  ASSERT_EQ(mcts.GetStats().simulations, 4u);
+  ASSERT_EQ(mcts.GetStats().simulations_saved, 0u);
+  ASSERT_EQ(root->GetVisitCount(), 4);
+}
+
+TEST(MCTSTests, ZeroTimeCheckIntervalChecksEverySimulation) {
+  auto game = FixedConnect4Game();
+  auto model = GetUniformMockModel(/*board_size=*/42, /*action_size=*/7);
+  MCTSOptions options;
+  options.time_check_interval = 0;
+  auto mcts = BasicMCTS<FixedConnect4Game>(game, model, options);
+
+  auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+  auto root = std::unique_ptr<Node>(mcts.RunUntil(
+      FixedConnect4Game::GetInitBoard(), /*to_play=*/1, deadline));
+
+  ASSERT_EQ(mcts.GetStats().simulations, 1u);
+}
+
+TEST(MCTSTests, StopFlagEndsSearch) {
+  auto game = FixedConnect4Game();
+  Connect2MockModel model(/*board_size=*/42, /*action_size=*/7,
+                          std::vector<float>(7, 1.0 / 7), 0.0001);
+  MCTSOptions options;
+  options.time_check_interval = 2;
+  auto mcts = BasicMCTS<FixedConnect4Game>(game, model, options);
+  std::atomic<bool> stop(true);
+
+  Node root(0, /*toPlay=*/1, /*action=*/-1);
+  mcts.Search(&root, FixedConnect4Game::GetInitBoard(),
+              BasicMCTS<FixedConnect4Game>::kUnlimited,
+              std::chrono::steady_clock::time_point::max(), &stop);
+
+  ASSERT_EQ(root.GetVisitCount(), 2);
+}
+
+TEST(MCTSTests, SearchContinuesAnEarlierTree) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.1, 0.3, 0.3, 0.3}, 0.0001);
+  std::vector<int> state = {-1, 0, 0, 0};
+  auto mcts = MCTS(game, model);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(state, /*to_play=*/1, /*num_simulations=*/20));
+  auto num_nodes = 1 + root->CountDescendants();
+  mcts.Search(root.get(), state, /*max_simulations=*/30);
+
+  ASSERT_EQ(root->GetVisitCount(), 50);
+  ASSERT_EQ(mcts.GetStats().searches, 2u);
+  ASSERT_EQ(mcts.GetStats().simulations, 50u);
+  ASSERT_GE(1 + root->CountDescendants(), num_nodes);
+}
+
+TEST(MCTSTests, ReleasedChildKeepsItsSubtree) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  std::vector<int> state = {0, 0, 0, 0};
+  auto mcts = MCTS(game, model);
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(state, /*to_play=*/1, /*num_simulations=*/50));
+  auto visits = root->GetChildByAction(1)->GetVisitCount();
+  auto descendants = root->GetChildByAction(1)->CountDescendants();
+
+  auto child = root->ReleaseChildByAction(1);
+  root.reset();
+
+  ASSERT_EQ(child->GetAction(), 1);
+  ASSERT_EQ(child->GetPlayerId(), -1);
+  ASSERT_EQ(child->GetVisitCount(), visits);
+  ASSERT_EQ(child->CountDescendants(), descendants);
+
+  // The child's position, seen by the player to move there
+  std::vector<int> child_state = {0, -1, 0, 0};
+  mcts.Search(child.get(), child_state, /*max_simulations=*/10);
+  ASSERT_EQ(child->GetVisitCount(), visits + 10);
+}
@@ -0,0 +1,37 @@
+#ifndef MOCK_EVALUATOR_H
+#define MOCK_EVALUATOR_H
+
+#include <evaluator.h>
+
+#include <vector>
+
+// Predicts the same action probabilities and value for every board
+struct Connect2MockModel : Evaluator {
+  std::vector<float> action_probs;
+  float value;
+
+  Connect2MockModel(int board_size, int action_size,
+                    std::vector<float> action_probs, float value)
+    : Evaluator(board_size, action_size), action_probs(action_probs),
+      value(value) {}
+
+  ActionProbsAndValue predict(std::vector<int>&) override {
+    return {action_probs, value};
+  }
+};
+
+// A mock for Connect2's board of four cells
+inline Connect2MockModel GetMockModel(std::vector<float> action_probs,
+                                      float value) {
+  return Connect2MockModel(/*board_size=*/4, /*action_size=*/4, action_probs,
+                           value);
+}
+
+// Uniform priors and an even value, for games of any size
+inline Connect2MockModel GetUniformMockModel(int board_size, int action_size) {
+  return Connect2MockModel(board_size, action_size,
+                           std::vector<float>(action_size, 1.0 / action_size),
+                           0);
+}
+
+#endif
@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
+#include <mapped_model.h>
 #include <model.h>
+#include <resnet_model.h>
+#include <weight_export.h>
+
+#include <cstdio>
 
 TEST(ModelTests, EnsureWeCanCreateModel) {
   Connect2Model model(4, 4, torch::kCPU);
@@ -33,3 +38,125 @@ TEST(ModelTests, EnsureWeCanPredictOnNetwork) {
   // Make sure the input and output shapes match
   ASSERT_EQ(input.size(), output.action_probs.size());
 }
+
+TEST(ModelTests, LogitsSoftmaxToPredictedProbabilities) {
+  Connect2Model model(4, 4, torch::kCPU);
+
+  std::vector<int> input = {0, 1, -1, 0};
+  auto probs = model.predict(input);
+  auto logits = model.predict_logits(input);
+
+  ASSERT_EQ(probs.value, logits.value);
+  auto softmax = torch::softmax(
+      torch::tensor(logits.action_logits, torch::kFloat32), 0);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NEAR(softmax[i].item<float>(), probs.action_probs[i], 1e-6);
+  }
+}
+
+TEST(ModelTests, PredictBatchMatchesSinglePredictions) {
+  Connect2Model model(4, 4, torch::kCPU);
+  std::vector<int> boards = {0, 1, -1, 0, 1, 0, 0, 0, 0, 0, 0, -1};
+
+  // Twice, so that the second call reuses the buffers
+  model.predict_batch(boards.data(), /*batch_size=*/3);
+  auto batch = model.predict_batch(boards.data(), /*batch_size=*/3);
+  ASSERT_EQ(batch.batch_size, 3);
+  // The views are only valid until the next call
+  std::vector<float> logits(batch.action_logits, batch.action_logits + 12);
+  std::vector<float> values(batch.values, batch.values + 3);
+
+  for (int i = 0; i < 3; ++i) {
+    std::vector<int> board(boards.begin() + 4 * i,
+                           boards.begin() + 4 * (i + 1));
+    auto single = model.predict_logits(board);
+    ASSERT_NEAR(values[i], single.value, 1e-6);
+    for (int action = 0; action < 4; ++action) {
+      ASSERT_NEAR(logits[4 * i + action], single.action_logits[action], 1e-6);
+    }
+  }
+}
+
+TEST(ModelTests, ResNetOutputShapes) {
+  ResNetOptions options{/*rows=*/6, /*columns=*/7, /*action_size=*/7,
+                        /*channels=*/8, /*num_blocks=*/2};
+  ResNetModel model(options, torch::kCPU);
+
+  auto input = torch::zeros({3, 42});
+  auto output = model.forward(input);
+
+  ASSERT_EQ(output.action_probs.size(0), 3);
+  ASSERT_EQ(output.action_probs.size(1), 7);
+  ASSERT_EQ(output.value.size(0), 3);
+  ASSERT_EQ(output.value.size(1), 1);
+}
+
+TEST(ModelTests, ResNetFoldedInferenceMatchesEvalForward) {
+  ResNetOptions options{/*rows=*/6, /*columns=*/7, /*action_size=*/7,
+                        /*channels=*/8, /*num_blocks=*/2};
+  ResNetModel model(options, torch::kCPU);
+
+  // Move the batch norm statistics away from their initial values
+  model.train();
+  model.forward(torch::randint(-1, 2, {16, 42}).to(torch::kFloat32));
+
+  auto input = torch::randint(-1, 2, {4, 42}).to(torch::kFloat32);
+  model.eval();
+  torch::NoGradGuard guard;
+  auto expected = model.forward(input);
+  auto folded = model.forward_inference(input);
+
+  ASSERT_TRUE(torch::allclose(expected.action_probs, folded.action_probs,
+                              /*rtol=*/1e-4, /*atol=*/1e-5));
+  ASSERT_TRUE(torch::allclose(expected.value, folded.value, /*rtol=*/1e-4,
+                              /*atol=*/1e-5));
+}
+
+TEST(ModelTests, ResNetRefoldsWhenWeightsChangeInEvalMode) {
+  ResNetOptions options{/*rows=*/6, /*columns=*/7, /*action_size=*/7,
+                        /*channels=*/8, /*num_blocks=*/2};
+  ResNetModel model(options, torch::kCPU);
+  auto input = torch::randint(-1, 2, {4, 42}).to(torch::kFloat32);
+  model.eval();
+  torch::NoGradGuard guard;
+  model.forward_inference(input);
+
+  // As loading or a WeightSubscriber refresh would, without a training pass
+  model.stem->bn->running_mean.add_(0.5);
+  model.value_fc2->bias.add_(0.5);
+  auto expected = model.forward(input);
+  auto folded = model.forward_inference(input);
+
+  ASSERT_TRUE(torch::allclose(expected.action_probs, folded.action_probs,
+                              /*rtol=*/1e-4, /*atol=*/1e-5));
+  ASSERT_TRUE(torch::allclose(expected.value, folded.value, /*rtol=*/1e-4,
+                              /*atol=*/1e-5));
+
+  model.train();
+  model.forward_inference(input);
+  ASSERT_TRUE(model.is_training());
+}
+
+TEST(ModelTests, MappedModelMatchesExportedModel) {
+  Connect2Model model(4, 4, torch::kCPU);
+  auto path = testing::TempDir() + "mapped_model.bin";
+  ExportWeights(model, path);
+  MappedConnect2Model mapped(path, 4, 4);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(mapped.GetHiddenSize(), 16);
+  std::vector<int> boards = {0, 1, -1, 0, 1, 0, 0, 0, 0, 0, 0, -1};
+  auto expected = model.predict_batch(boards.data(), /*batch_size=*/3);
+  std::vector<float> logits(expected.action_logits,
+                            expected.action_logits + 12);
+  std::vector<float> values(expected.values, expected.values + 3);
+
+  auto actual = mapped.predict_batch(boards.data(), /*batch_size=*/3);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_NEAR(actual.values[i], values[i], 1e-5);
+    for (int action = 0; action < 4; ++action) {
+      ASSERT_NEAR(actual.action_logits[4 * i + action], logits[4 * i + action],
+                  1e-5);
+    }
+  }
+}
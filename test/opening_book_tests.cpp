@@ -0,0 +1,204 @@
+#include <game.h>
+#include <game_record.h>
+#include <gtest/gtest.h>
+#include <monte_carlo_tree_search.h>
+#include <opening_book.h>
+#include <rollout_evaluator.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+
+#include "mock_evaluator.h"
+
+TEST(OpeningBookTests, SearchesEveryPositionUpToMaxDepth) {
+  Connect2Game game;
+  RolloutEvaluator evaluator(1, 4, 2);
+  BookPositions positions;
+
+  AddSearchedPositions(game, evaluator, /*max_depth=*/1,
+                       /*num_simulations=*/200, MCTSOptions(), positions);
+
+  // The start and the opponent's view after each of the four first moves
+  ASSERT_EQ(positions.size(), 5);
+  const auto& start = positions.at(HashBoard({0, 0, 0, 0}));
+  ASSERT_EQ(start.num_samples, 1);
+  ASSERT_GT(start.value_sum, 0);
+  // The first player wins Connect2 by taking an inner cell
+  auto best = std::max_element(start.visit_counts.begin(),
+                               start.visit_counts.end()) -
+              start.visit_counts.begin();
+  ASSERT_TRUE(best == 1 || best == 2);
+  ASSERT_EQ(positions.count(HashBoard({0, -1, 0, 0})), 1);
+}
+
+TEST(OpeningBookTests, BooksTheProvenMoveOfSolvedPositions) {
+  Connect4Game game;
+  // Column 3 wins at once. The priors draw the search elsewhere, so the
+  // solver proves the win before column 3 has the most visits.
+  std::vector<int> board(game.GetBoardSize(), 0);
+  for (int column = 0; column < 3; ++column) {
+    board[5 * 7 + column] = 1;
+    board[4 * 7 + column] = -1;
+  }
+  Connect2MockModel model(game.GetBoardSize(), game.GetActionSize(),
+                          {0.3, 0.3, 0.3, 0.01, 0.03, 0.03, 0.03}, 0);
+  MCTSOptions options;
+  options.use_solver = true;
+  BookPositions positions;
+
+  AddSearchedPositions(game, model, board, /*max_depth=*/0,
+                       /*num_simulations=*/200, options, positions);
+  const auto& position = positions.at(HashBoard(board));
+  ASSERT_EQ(position.visit_counts,
+            std::vector<float>({0, 0, 0, 1, 0, 0, 0}));
+  ASSERT_EQ(position.value_sum, 1);
+
+  auto path = testing::TempDir() + "opening_book_solved.bin";
+  WriteOpeningBook(path, game.GetBoardSize(), game.GetActionSize(), positions);
+  OpeningBook book(path);
+  std::remove(path.c_str());
+  options.opening_book = &book;
+  MCTS book_mcts(game, model, options);
+  auto root = std::unique_ptr<Node>(
+      book_mcts.Run(board, /*to_play=*/1, /*num_simulations=*/200));
+  ASSERT_EQ(book_mcts.GetStats().book_hits, 1u);
+  ASSERT_EQ(root->SelectAction(/*temperature=*/0), 3);
+}
+
+TEST(OpeningBookTests, AggregatesRecordedGames) {
+  Connect2Game game;
+  auto records_path = testing::TempDir() + "opening_book_records.bin";
+  {
+    GameRecordWriter writer(records_path);
+    GameRecord record;
+    record.action_size = 4;
+    record.moves = {1, 0, 2};
+    record.visit_counts = {{0, 6, 2, 0}, {3, 0, 1, 0}, {0, 0, 5, 0}};
+    record.result = 1;
+    writer.Add(record);
+    record.moves = {1, 2, 0};
+    record.visit_counts = {{0, 4, 4, 0}, {1, 0, 3, 0}, {5, 0, 0, 0}};
+    writer.Add(record);
+  }
+  BookPositions positions;
+
+  AddRecordedGames(game, records_path, /*max_depth=*/1, positions);
+  std::remove(records_path.c_str());
+
+  ASSERT_EQ(positions.size(), 2);
+  const auto& start = positions.at(HashBoard({0, 0, 0, 0}));
+  ASSERT_EQ(start.visit_counts, std::vector<float>({0, 10, 6, 0}));
+  ASSERT_EQ(start.num_samples, 2);
+  ASSERT_EQ(start.value_sum, 2);
+  // The second player's view, who lost both games
+  const auto& reply = positions.at(HashBoard({0, -1, 0, 0}));
+  ASSERT_EQ(reply.visit_counts, std::vector<float>({4, 0, 4, 0}));
+  ASSERT_EQ(reply.value_sum, -2);
+}
+
+TEST(OpeningBookTests, RoundTripsThroughFile) {
+  BookPositions positions;
+  positions[HashBoard({0, 0, 0, 0})] = {{0, 30, 10, 0}, 1.5, 3};
+  positions[HashBoard({0, -1, 0, 0})] = {{2, 0, 6, 0}, -2, 2};
+  auto path = testing::TempDir() + "opening_book_round_trip.bin";
+
+  WriteOpeningBook(path, /*board_size=*/4, /*action_size=*/4, positions);
+  OpeningBook book(path);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(book.GetNumEntries(), 2);
+  ASSERT_EQ(book.GetActionSize(), 4);
+  auto start = book.Lookup({0, 0, 0, 0});
+  ASSERT_TRUE(start.has_value());
+  ASSERT_EQ(std::vector<uint16_t>(start->visit_counts,
+                                  start->visit_counts + 4),
+            std::vector<uint16_t>({0, 30, 10, 0}));
+  ASSERT_FLOAT_EQ(start->value, 0.5);
+  ASSERT_FLOAT_EQ(book.Lookup({0, -1, 0, 0})->value, -1);
+  ASSERT_EQ(book.Lookup({1, -1, 0, 0}), std::nullopt);
+  ASSERT_EQ(book.Lookup({0, 0, 0}), std::nullopt);
+}
+
+TEST(OpeningBookTests, RejectsOtherFiles) {
+  auto path = testing::TempDir() + "opening_book_invalid.bin";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "not an opening book, but long enough for a header";
+  }
+
+  ASSERT_THROW(OpeningBook book(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(OpeningBookTests, RejectsCorruptHeader) {
+  BookPositions positions;
+  positions[HashBoard({0, 0, 0, 0})] = {{0, 30, 10, 0}, 0.5, 1};
+  auto path = testing::TempDir() + "opening_book_corrupt.bin";
+  WriteOpeningBook(path, /*board_size=*/4, /*action_size=*/4, positions);
+  {
+    // A slot count that isn't a power of two
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t num_slots = 3;
+    file.seekp(offsetof(OpeningBookHeader, num_slots));
+    file.write(reinterpret_cast<const char*>(&num_slots), sizeof(num_slots));
+  }
+
+  ASSERT_THROW(OpeningBook book(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(OpeningBookTests, SearchPlaysBookPositionsWithoutSimulating) {
+  Connect2Game game;
+  BookPositions positions;
+  positions[HashBoard({0, 0, 0, 0})] = {{0, 30, 10, 0}, 0.5, 1};
+  auto path = testing::TempDir() + "opening_book_search.bin";
+  WriteOpeningBook(path, game.GetBoardSize(), game.GetActionSize(), positions);
+  OpeningBook book(path);
+  std::remove(path.c_str());
+
+  // Priors the book should override
+  auto model = GetMockModel({0.7, 0.1, 0.1, 0.1}, -0.9);
+  MCTSOptions options;
+  options.opening_book = &book;
+  auto mcts = MCTS(game, model, options);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run({0, 0, 0, 0}, /*to_play=*/1, /*num_simulations=*/100));
+
+  ASSERT_EQ(root->GetNumChildren(), 2);
+  ASSERT_EQ(root->GetChildByAction(1)->GetVisitCount(), 30);
+  ASSERT_EQ(root->GetChildByAction(2)->GetVisitCount(), 10);
+  ASSERT_FLOAT_EQ(root->GetValue(), 0.5);
+  ASSERT_FLOAT_EQ(root->GetChildByAction(1)->GetValue(), -0.5);
+  ASSERT_EQ(root->SelectAction(/*temperature=*/0), 1);
+  ASSERT_EQ(mcts.GetStats().book_hits, 1);
+  ASSERT_EQ(mcts.GetStats().simulations, 0);
+
+  // Positions that aren't in the book are searched as usual
+  root.reset(mcts.Run({0, -1, 0, 0}, /*to_play=*/1, /*num_simulations=*/100));
+  ASSERT_EQ(mcts.GetStats().book_hits, 1);
+  ASSERT_EQ(mcts.GetStats().simulations, 100);
+}
+
+TEST(OpeningBookTests, SearchIgnoresBooksOfOtherGames) {
+  // The same number of cells as Connect2, but two columns of two
+  BookPositions positions;
+  positions[HashBoard({0, 0, 0, 0})] = {{3, 1}, 0.5, 1};
+  auto path = testing::TempDir() + "opening_book_other_game.bin";
+  WriteOpeningBook(path, /*board_size=*/4, /*action_size=*/2, positions);
+  OpeningBook book(path);
+  std::remove(path.c_str());
+
+  Connect2Game game;
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0);
+  MCTSOptions options;
+  options.opening_book = &book;
+  auto mcts = MCTS(game, model, options);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run({0, 0, 0, 0}, /*to_play=*/1, /*num_simulations=*/10));
+
+  ASSERT_EQ(mcts.GetStats().book_hits, 0u);
+  ASSERT_EQ(mcts.GetStats().simulations, 10u);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <ponderer.h>
+
+#include <chrono>
+#include <thread>
+
+#include "mock_evaluator.h"
+
+TEST(PondererTests, LatencyPercentilesUseNearestRank) {
+  LatencyStats stats;
+  for (int i = 1; i <= 100; ++i) {
+    stats.Record(i / 1000.0, (i - 90) / 1000.0);
+  }
+
+  ASSERT_EQ(stats.GetNumMoves(), 100);
+  ASSERT_DOUBLE_EQ(stats.GetLatencyPercentile(0.5), 0.051);
+  ASSERT_DOUBLE_EQ(stats.GetLatencyPercentile(1.0), 0.1);
+  ASSERT_DOUBLE_EQ(stats.GetOverrunPercentile(0.5), 0);
+  ASSERT_DOUBLE_EQ(stats.GetOverrunPercentile(0.99), 0.01);
+}
+
+TEST(PondererTests, SelectMoveMeetsTheDeadline) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  Ponderer ponderer(game, model);
+
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+  auto action = ponderer.SelectMove({0, 0, 0, 0}, deadline);
+
+  ASSERT_GE(action, 0);
+  ASSERT_LT(action, 4);
+  ASSERT_GE(std::chrono::steady_clock::now(), deadline);
+  ASSERT_EQ(ponderer.GetLatency().GetNumMoves(), 1);
+  ASSERT_GT(ponderer.GetSearchStats().simulations, 0u);
+}
+
+TEST(PondererTests, ReusesThePonderedReply) {
+  auto game = Connect4Game();
+  Connect2MockModel model(/*board_size=*/42, /*action_size=*/7,
+                          std::vector<float>(7, 1.0 / 7), 0.0001);
+  Ponderer ponderer(game, model);
+
+  auto state = game.GetInitBoard();
+  auto action = ponderer.SelectMove(
+      state, std::chrono::steady_clock::now() + std::chrono::milliseconds(5));
+  ponderer.StartPondering(/*max_simulations=*/200);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // The opponent replies in the next column over
+  state = game.GetNextState(state, 1, action).board;
+  state = game.GetNextState(state, -1, (action + 1) % 7).board;
+  ponderer.SelectMove(
+      state, std::chrono::steady_clock::now() + std::chrono::milliseconds(5));
+
+  ASSERT_EQ(ponderer.GetStats().moves, 2u);
+  ASSERT_EQ(ponderer.GetStats().hits, 1u);
+  ASSERT_GT(ponderer.GetStats().reused_visits, 0u);
+}
+
+TEST(PondererTests, UnexpectedPositionStartsAFreshTree) {
+  auto game = Connect2Game();
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0.0001);
+  Ponderer ponderer(game, model);
+
+  auto now = std::chrono::steady_clock::now();
+  ponderer.SelectMove({0, 0, 0, 0}, now + std::chrono::milliseconds(2));
+  ponderer.StartPondering(/*max_simulations=*/50);
+  // Not reachable from the previous position
+  ponderer.SelectMove({1, -1, 1, 0}, now + std::chrono::milliseconds(4));
+
+  ASSERT_EQ(ponderer.GetStats().hits, 0u);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <prioritized_replay.h>
+
+TEST(PrioritizedReplayTests, SumTreeKeepsTheTotal) {
+  SumTree tree(5);
+  tree.Set(0, 1);
+  tree.Set(3, 2.5);
+  tree.Set(4, 0.5);
+  ASSERT_DOUBLE_EQ(tree.GetTotal(), 4);
+
+  tree.Set(3, 1);
+  ASSERT_DOUBLE_EQ(tree.GetTotal(), 2.5);
+  ASSERT_DOUBLE_EQ(tree.Get(3), 1);
+  ASSERT_EQ(tree.GetSize(), 5u);
+}
+
+TEST(PrioritizedReplayTests, SumTreeFindsTheSliceContainingAValue) {
+  SumTree tree(5);
+  tree.Set(0, 1);
+  tree.Set(2, 2);
+  tree.Set(4, 1);
+
+  ASSERT_EQ(tree.Find(0), 0u);
+  ASSERT_EQ(tree.Find(0.99), 0u);
+  ASSERT_EQ(tree.Find(1), 2u);
+  ASSERT_EQ(tree.Find(2.99), 2u);
+  ASSERT_EQ(tree.Find(3.5), 4u);
+  // Past the end lands on the last non-empty leaf
+  ASSERT_EQ(tree.Find(4.01), 4u);
+}
+
+TEST(PrioritizedReplayTests, UniformBeforeAnyUpdate) {
+  PrioritizedReplay replay(8, PrioritizedReplayOptions());
+  std::mt19937 generator(0);
+
+  auto indices = replay.Sample(8, generator);
+  auto weights = replay.GetImportanceWeights(indices);
+
+  // Stratified sampling draws one index from each equal slice
+  for (size_t i = 0; i < indices.size(); ++i) {
+    ASSERT_EQ(indices[i], i);
+    ASSERT_FLOAT_EQ(weights[i], 1);
+  }
+}
+
+TEST(PrioritizedReplayTests, HighLossExamplesAreSampledMoreOften) {
+  PrioritizedReplayOptions options;
+  options.alpha = 1;
+  options.epsilon = 0;
+  PrioritizedReplay replay(4, options);
+  replay.Update({0, 1, 2, 3}, {0.1, 0.1, 0.1, 9.7});
+  std::mt19937 generator(0);
+
+  int high_loss_samples = 0;
+  for (int i = 0; i < 100; ++i) {
+    for (auto index : replay.Sample(10, generator)) {
+      high_loss_samples += index == 3;
+    }
+  }
+  ASSERT_NEAR(high_loss_samples / 1000.0, 0.97, 0.02);
+
+  // The rare examples get the full weight, the frequent one much less
+  auto weights = replay.GetImportanceWeights({0, 3});
+  ASSERT_FLOAT_EQ(weights[0], 1);
+  ASSERT_LT(weights[1], weights[0]);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <puct.h>
+
+#include <random>
+
+TEST(PuctTests, PicksHighestPriorWhenUnvisited) {
+  std::vector<float> priors = {0.1, 0.2, 0.4, 0.1, 0.2};
+  std::vector<int> visit_counts = {0, 0, 0, 0, 0};
+  std::vector<float> value_sums = {0, 0, 0, 0, 0};
+
+  auto index = SelectPuctIndex(priors.data(), visit_counts.data(),
+                               value_sums.data(), priors.size(),
+                               /*c_puct=*/1.0, /*sqrt_parent_visits=*/1.0);
+
+  ASSERT_EQ(index, 2);
+}
+
+TEST(PuctTests, PrefersChildThatIsBadForOpponent) {
+  // Values are stored from the child's point of view, so a negative value sum
+  // is a good move for the parent.
+  std::vector<float> priors = {0.25, 0.25, 0.25, 0.25};
+  std::vector<int> visit_counts = {4, 4, 4, 4};
+  std::vector<float> value_sums = {2, -3, 1, 0};
+
+  auto index = SelectPuctIndex(priors.data(), visit_counts.data(),
+                               value_sums.data(), priors.size(),
+                               /*c_puct=*/1.0, /*sqrt_parent_visits=*/4.0);
+
+  ASSERT_EQ(index, 1);
+}
+
+TEST(PuctTests, LargerCPuctFavoursExploration) {
+  std::vector<float> priors = {0.2, 0.8};
+  std::vector<int> visit_counts = {10, 0};
+  std::vector<float> value_sums = {-5, 0};
+
+  auto greedy = SelectPuctIndex(priors.data(), visit_counts.data(),
+                                value_sums.data(), priors.size(),
+                                /*c_puct=*/0.1, /*sqrt_parent_visits=*/3.0);
+  auto exploring = SelectPuctIndex(priors.data(), visit_counts.data(),
+                                   value_sums.data(), priors.size(),
+                                   /*c_puct=*/4.0, /*sqrt_parent_visits=*/3.0);
+
+  ASSERT_EQ(greedy, 0);
+  ASSERT_EQ(exploring, 1);
+}
+
+TEST(PuctTests, TiesGoToLowestIndex) {
+  std::vector<float> priors(9, 0.1);
+  std::vector<int> visit_counts(9, 1);
+  std::vector<float> value_sums(9, 0);
+
+  auto index = SelectPuctIndex(priors.data(), visit_counts.data(),
+                               value_sums.data(), priors.size(),
+                               /*c_puct=*/1.0, /*sqrt_parent_visits=*/3.0);
+
+  ASSERT_EQ(index, 0);
+}
+
+TEST(PuctTests, VectorizedMatchesScalar) {
+  std::mt19937 generator(1234);
+  std::uniform_real_distribution<float> prior_distr(0, 1);
+  std::uniform_int_distribution<int> visit_distr(0, 50);
+  std::uniform_real_distribution<float> value_distr(-1, 1);
+
+  for (int num_children = 1; num_children < 40; ++num_children) {
+    std::vector<float> priors(num_children), value_sums(num_children);
+    std::vector<int> visit_counts(num_children);
+    int parent_visits = 1;
+    for (int i = 0; i < num_children; ++i) {
+      priors[i] = prior_distr(generator);
+      visit_counts[i] = visit_distr(generator);
+      value_sums[i] = value_distr(generator) * visit_counts[i];
+      parent_visits += visit_counts[i];
+    }
+    float sqrt_parent_visits = std::sqrt(static_cast<float>(parent_visits));
+
+    ASSERT_EQ(SelectPuctIndex(priors.data(), visit_counts.data(),
+                              value_sums.data(), num_children, 1.5,
+                              sqrt_parent_visits),
+              SelectPuctIndexScalar(priors.data(), visit_counts.data(),
+                                    value_sums.data(), num_children, 1.5,
+                                    sqrt_parent_visits));
+  }
+}
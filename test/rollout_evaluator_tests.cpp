@@ -0,0 +1,152 @@
+#include <game.h>
+#include <gtest/gtest.h>
+#include <monte_carlo_tree_search.h>
+#include <rollout_evaluator.h>
+
+#include <random>
+
+TEST(RolloutEvaluatorTests, FindLinesMatchesGame) {
+  using Game = FixedConnect4Game;
+  BitboardLayout layout(Game::kRows, Game::kColumns, Game::kNumToWin);
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<int> cell_distr(-1, 1);
+
+  // Odd so that the vector loop leaves a remainder
+  const int kNumBoards = 31;
+  std::vector<Game::Board> boards(kNumBoards);
+  std::vector<uint64_t> stones(kNumBoards);
+  for (int i = 0; i < kNumBoards; ++i) {
+    for (auto& cell : boards[i]) {
+      cell = cell_distr(generator);
+    }
+    stones[i] = layout.ToBitboard(boards[i].data(), 1);
+  }
+
+  auto lines = FindLines(stones.data(), kNumBoards, layout);
+  ASSERT_EQ(lines, FindLinesScalar(stones.data(), kNumBoards, layout));
+  int num_wins = 0;
+  for (int i = 0; i < kNumBoards; ++i) {
+    ASSERT_EQ((lines >> i & 1) != 0, Game::IsWin(boards[i], 1));
+    num_wins += Game::IsWin(boards[i], 1);
+  }
+  // Random boards have lines and lack them often enough to test both
+  ASSERT_GT(num_wins, 0);
+  ASSERT_LT(num_wins, kNumBoards);
+}
+
+TEST(RolloutEvaluatorTests, FirstMovePriorFindsImmediateWin) {
+  // Three in the bottom row for the player to move, the opponent's three on
+  // top of them
+  std::vector<int> board(42, 0);
+  for (int column = 0; column < 3; ++column) {
+    board[5 * 7 + column] = 1;
+    board[4 * 7 + column] = -1;
+  }
+  RolloutOptions options;
+  options.num_rollouts = 200;
+  options.first_move_prior_scale = 2;
+  RolloutEvaluator evaluator(6, 7, 4, options);
+
+  auto result = evaluator.predict_logits(board);
+
+  // Every playout starting in column 3 is won on the spot
+  ASSERT_FLOAT_EQ(result.action_logits[3], 2);
+  for (int action = 0; action < 7; ++action) {
+    if (action != 3) {
+      ASSERT_LT(result.action_logits[action], 2);
+    }
+  }
+  ASSERT_GT(result.value, 0);
+  ASSERT_EQ(evaluator.GetNumRollouts(), 200u);
+}
+
+TEST(RolloutEvaluatorTests, FinishedBoardsAreNotPlayedOut) {
+  std::vector<int> board = {0, -1, -1, 1};
+  RolloutEvaluator evaluator(1, 4, 2);
+
+  auto result = evaluator.predict(board);
+
+  ASSERT_EQ(result.value, -1);
+  ASSERT_EQ(evaluator.GetNumRollouts(), 0u);
+  // The prior is uniform by default
+  for (auto prob : result.action_probs) {
+    ASSERT_FLOAT_EQ(prob, 0.25);
+  }
+}
+
+TEST(RolloutEvaluatorTests, FullBoardsAreDrawn) {
+  // Connect2 with only the last cell left, which can't make a pair
+  std::vector<int> board = {-1, 1, -1, 0};
+  RolloutEvaluator evaluator(1, 4, 2);
+
+  ASSERT_EQ(evaluator.predict(board).value, 0);
+}
+
+TEST(RolloutEvaluatorTests, SameSeedGivesSameValues) {
+  std::vector<int> boards(2 * 42, 0);
+  boards[42 + 5 * 7 + 3] = -1;
+  RolloutEvaluator a(6, 7, 4), b(6, 7, 4);
+
+  auto first = a.predict_batch(boards.data(), /*batch_size=*/2);
+  std::vector<float> values(first.values, first.values + 2);
+  auto second = b.predict_batch(boards.data(), /*batch_size=*/2);
+
+  ASSERT_EQ(values[0], second.values[0]);
+  ASSERT_EQ(values[1], second.values[1]);
+  ASSERT_EQ(a.GetNumRollouts(), 2u * RolloutOptions().num_rollouts);
+}
+
+TEST(RolloutEvaluatorTests, SearchBlocksOpponentsWin) {
+  // The opponent threatens to complete the bottom row in column 3
+  auto board = FixedConnect4Game::GetInitBoard();
+  for (int column = 0; column < 3; ++column) {
+    board[5 * 7 + column] = -1;
+  }
+  board[5 * 7 + 6] = 1;
+  board[4 * 7 + 6] = 1;
+  RolloutEvaluator evaluator(6, 7, 4);
+  auto mcts = BasicMCTS<FixedConnect4Game>(FixedConnect4Game(), evaluator);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run(board, /*to_play=*/1, /*num_simulations=*/400));
+
+  ASSERT_EQ(root->SelectAction(/*temperature=*/0), 3);
+}
+
+TEST(RolloutEvaluatorTests, BatchPlaysOutEveryLeaf) {
+  // An immediate win for the player to move, a finished game and an empty
+  // board, with fewer playouts each than there are lanes
+  std::vector<int> boards(3 * 42, 0);
+  for (int column = 0; column < 3; ++column) {
+    boards[5 * 7 + column] = 1;
+    boards[4 * 7 + column] = -1;
+  }
+  for (int column = 0; column < 4; ++column) {
+    boards[42 + 5 * 7 + column] = -1;
+  }
+  RolloutOptions options;
+  options.num_rollouts = 3;
+  options.first_move_prior_scale = 1;
+  RolloutEvaluator evaluator(6, 7, 4, options);
+
+  auto batch = evaluator.predict_batch(boards.data(), 3);
+
+  ASSERT_EQ(batch.batch_size, 3);
+  ASSERT_EQ(batch.values[1], -1);
+  for (int i : {0, 2}) {
+    ASSERT_GE(batch.values[i], -1);
+    ASSERT_LE(batch.values[i], 1);
+  }
+  // Only the finished board isn't played out, and its prior stays uniform
+  ASSERT_EQ(evaluator.GetNumRollouts(), 6u);
+  for (int action = 0; action < 7; ++action) {
+    ASSERT_EQ(batch.GetActionLogits(1)[action], 0);
+  }
+  // Column 3 wins on the spot, if a playout started there at all
+  for (int action = 0; action < 7; ++action) {
+    ASSERT_GE(batch.GetActionLogits(0)[action], -1);
+    ASSERT_LE(batch.GetActionLogits(0)[action], 1);
+  }
+  auto winning_logit = batch.GetActionLogits(0)[3];
+  ASSERT_TRUE(winning_logit == 0 || winning_logit == 1);
+}
@@ -0,0 +1,127 @@
+#include <game.h>
+#include <gtest/gtest.h>
+#include <monte_carlo_tree_search.h>
+#include <tablebase.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "mock_evaluator.h"
+
+TEST(TablebaseTests, SolvesConnect2) {
+  Connect2Game game;
+
+  auto endgames = SolveEndgames(game, /*max_empty_cells=*/4);
+
+  // The first player wins Connect2 by taking an inner cell
+  ASSERT_EQ(endgames.at(HashBoard({0, 0, 0, 0})), 1);
+  // Wherever we play, the opponent completes a pair
+  ASSERT_EQ(endgames.at(HashBoard({0, -1, 0, 0})), -1);
+  // Only a draw is left
+  ASSERT_EQ(endgames.at(HashBoard({1, -1, 0, 0})), 0);
+}
+
+TEST(TablebaseTests, OnlyKeepsUnfinishedPositionsWithFewEmptyCells) {
+  Connect2Game game;
+
+  auto endgames = SolveEndgames(game, /*max_empty_cells=*/2);
+
+  ASSERT_EQ(endgames.count(HashBoard({0, 0, 0, 0})), 0);
+  ASSERT_EQ(endgames.count(HashBoard({0, -1, 0, 0})), 0);
+  ASSERT_EQ(endgames.count(HashBoard({1, -1, 0, 0})), 1);
+  // Finished games are left to the game itself
+  ASSERT_EQ(endgames.count(HashBoard({1, 1, -1, 0})), 0);
+}
+
+TEST(TablebaseTests, SolvesOtherConfigurations) {
+  auto game = MakeConnectXGame(/*rows=*/4, /*columns=*/4, /*num_to_win=*/3);
+
+  auto endgames = SolveEndgames(*game, /*max_empty_cells=*/2);
+
+  // Dropping into the last empty cell completes a diagonal
+  std::vector<int> board = {1,  -1, -1, 0,
+                            -1, -1, 1,  -1,
+                            1,  1,  -1, 1,
+                            -1, 1,  -1, 1};
+  ASSERT_EQ(endgames.at(HashBoard(board)), 1);
+  for (auto& entry : endgames) {
+    ASSERT_TRUE(entry.second >= -1 && entry.second <= 1);
+  }
+}
+
+TEST(TablebaseTests, RoundTripsThroughFile) {
+  Connect2Game game;
+  auto endgames = SolveEndgames(game, /*max_empty_cells=*/4);
+  auto path = testing::TempDir() + "tablebase_round_trip.bin";
+
+  WriteTablebase(path, game.GetBoardSize(), game.GetActionSize(), endgames);
+  Tablebase tablebase(path);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(tablebase.GetNumEntries(), endgames.size());
+  ASSERT_EQ(tablebase.Lookup({0, 0, 0, 0}), 1);
+  ASSERT_EQ(tablebase.Lookup({0, -1, 0, 0}), -1);
+  ASSERT_EQ(tablebase.Lookup({1, -1, 0, 0}), 0);
+  // Finished games and boards of the wrong size aren't in the table
+  ASSERT_EQ(tablebase.Lookup({1, 1, -1, 0}), std::nullopt);
+  ASSERT_EQ(tablebase.Lookup({0, 0, 0}), std::nullopt);
+}
+
+TEST(TablebaseTests, RejectsCorruptHeader) {
+  Connect2Game game;
+  auto path = testing::TempDir() + "tablebase_corrupt.bin";
+  WriteTablebase(path, game.GetBoardSize(), game.GetActionSize(),
+                 SolveEndgames(game, /*max_empty_cells=*/4));
+  {
+    // A slot count that isn't a power of two
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t num_slots = 3;
+    file.seekp(offsetof(TablebaseHeader, num_slots));
+    file.write(reinterpret_cast<const char*>(&num_slots), sizeof(num_slots));
+  }
+
+  ASSERT_THROW(Tablebase tablebase(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(TablebaseTests, SearchRejectsTablesOfOtherGames) {
+  // The same number of cells as Connect2, but two columns of two
+  auto path = testing::TempDir() + "tablebase_other_game.bin";
+  WriteTablebase(path, /*board_size=*/4, /*action_size=*/2,
+                 {{HashBoard({0, 0, 0, 0}), -1}});
+  Tablebase tablebase(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(tablebase.GetActionSize(), 2);
+
+  Connect2Game game;
+  auto model = GetMockModel({0.25, 0.25, 0.25, 0.25}, 0);
+  MCTSOptions options;
+  options.tablebase = &tablebase;
+  ASSERT_THROW(MCTS(game, model, options), std::invalid_argument);
+}
+
+TEST(TablebaseTests, SearchUsesTablebaseValues) {
+  Connect2Game game;
+  auto path = testing::TempDir() + "tablebase_search.bin";
+  WriteTablebase(path, game.GetBoardSize(), game.GetActionSize(),
+                 SolveEndgames(game, /*max_empty_cells=*/3));
+  Tablebase tablebase(path);
+  std::remove(path.c_str());
+
+  // Priors and values that would mislead the search without the tablebase
+  auto model = GetMockModel({0.7, 0.1, 0.1, 0.1}, 0.9);
+  MCTSOptions options;
+  options.use_solver = true;
+  options.tablebase = &tablebase;
+  auto mcts = MCTS(game, model, options);
+
+  auto root = std::unique_ptr<Node>(
+      mcts.Run({0, 0, 0, 0}, /*to_play=*/1, /*num_simulations=*/100));
+
+  ASSERT_EQ(root->GetProvenValue(), ProvenValue::kWin);
+  auto action = root->SelectAction(/*temperature=*/0);
+  ASSERT_TRUE(action == 1 || action == 2);
+  ASSERT_LT(root->GetVisitCount(), 100);
+}
@@ -1,10 +1,30 @@
 #include <gtest/gtest.h>
 
+#include "arena_tests.cpp"
+#include "example_tests.cpp"
+#include "game_record_tests.cpp"
 #include "game_tests.cpp"
+#include "mapped_model_tests.cpp"
+#include "masked_softmax_tests.cpp"
 #include "mcts_tests.cpp"
+#include "opening_book_tests.cpp"
+#include "ponderer_tests.cpp"
+#include "prioritized_replay_tests.cpp"
+#include "puct_tests.cpp"
+#include "rollout_evaluator_tests.cpp"
+#include "tablebase_tests.cpp"
+#include "thread_budget_tests.cpp"
+#include "tracer_tests.cpp"
+#include "weight_file_tests.cpp"
+
+// Tests of the libtorch backend, only built when libtorch is found
+#if defined(ALPHAZERO_TORCH)
 #include "model_tests.cpp"
+#include "trainer_tests.cpp"
+#include "weight_publisher_tests.cpp"
+#endif
 
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
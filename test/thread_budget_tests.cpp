@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <thread_budget.h>
+
+#include <stdexcept>
+
+TEST(ThreadBudgetTests, FillsCoresWithSelfPlayWorkers) {
+  ThreadBudgetOptions options;
+  options.inference_threads = 2;
+  ThreadBudget budget(options, {0, 1, 2, 3, 4, 5, 6, 7});
+
+  ASSERT_EQ(budget.GetNumSelfPlayWorkers(), 4);
+  ASSERT_EQ(budget.GetNumThreads(ThreadRole::kSelfPlay), 2);
+  // Training runs between self-play phases and gets every core
+  ASSERT_EQ(budget.GetNumThreads(ThreadRole::kTraining), 8);
+}
+
+TEST(ThreadBudgetTests, GivesEachWorkerItsOwnCores) {
+  ThreadBudgetOptions options;
+  options.self_play_threads = 2;
+  options.inference_threads = 2;
+  options.training_threads = 3;
+  ThreadBudget budget(options, {4, 5, 0, 1, 2, 3});
+
+  ASSERT_EQ(budget.GetCores(ThreadRole::kSelfPlay, 0),
+            std::vector<int>({4, 5}));
+  ASSERT_EQ(budget.GetCores(ThreadRole::kSelfPlay, 1),
+            std::vector<int>({0, 1}));
+  ASSERT_EQ(budget.GetCores(ThreadRole::kTraining),
+            std::vector<int>({4, 5, 0}));
+}
+
+TEST(ThreadBudgetTests, RejectsOversubscription) {
+  ThreadBudgetOptions options;
+  options.self_play_threads = 3;
+  options.inference_threads = 2;
+  ASSERT_THROW(ThreadBudget(options, {0, 1, 2, 3}), std::invalid_argument);
+
+  options = ThreadBudgetOptions();
+  options.training_threads = 5;
+  ASSERT_THROW(ThreadBudget(options, {0, 1, 2, 3}), std::invalid_argument);
+}
+
+TEST(ThreadBudgetTests, AvailableCoresAreUsable) {
+  auto cores = ThreadBudget::GetAvailableCores();
+  ASSERT_GT(cores.size(), 0u);
+
+  ThreadBudgetOptions options;
+  options.pin_threads = true;
+  ThreadBudget budget(options);
+  ASSERT_EQ(budget.GetNumCores(), static_cast<int>(cores.size()));
+  budget.PinCurrentThread(ThreadRole::kTraining);
+}
+
+TEST(ThreadBudgetTests, RecordsUsagePerRole) {
+  ThreadBudget budget(ThreadBudgetOptions(), {0});
+  {
+    ScopedThreadUsage usage(budget, ThreadRole::kSelfPlay);
+    volatile double sum = 0;
+    for (int i = 0; i < 1000000; ++i) {
+      sum = sum + i;
+    }
+  }
+
+  ASSERT_GT(budget.GetUsage(ThreadRole::kSelfPlay).wall_seconds, 0);
+  ASSERT_EQ(budget.GetUsage(ThreadRole::kTraining).wall_seconds, 0);
+
+  budget.ResetUsage();
+  ASSERT_EQ(budget.GetUsage(ThreadRole::kSelfPlay).wall_seconds, 0);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <tracer.h>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+std::string ReadTrace(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+int CountOccurrences(const std::string& text, const std::string& pattern) {
+  int count = 0;
+  for (auto pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(TracerTests, RecordsNothingUntilStarted) {
+  auto path = testing::TempDir() + "trace_disabled.json";
+  Tracer::Stop();
+  Tracer::Clear();
+  { ScopedSpan span("ignored"); }
+
+  Tracer::WriteChromeTrace(path);
+  ASSERT_EQ(CountOccurrences(ReadTrace(path), "ignored"), 0);
+  std::remove(path.c_str());
+}
+
+TEST(TracerTests, WritesSpansFromEveryThread) {
+  auto path = testing::TempDir() + "trace_threads.json";
+  Tracer::Clear();
+  Tracer::Start();
+
+  auto record_spans = [] {
+    for (int i = 0; i < 10; ++i) {
+      ScopedSpan outer("outer");
+      ScopedSpan inner("inner");
+    }
+  };
+  std::thread first(record_spans), second(record_spans);
+  first.join();
+  second.join();
+  Tracer::Stop();
+
+  Tracer::WriteChromeTrace(path);
+  auto trace = ReadTrace(path);
+  ASSERT_EQ(trace.find("{\"displayTimeUnit\""), 0u);
+  ASSERT_EQ(CountOccurrences(trace, "\"name\":\"outer\""), 20);
+  ASSERT_EQ(CountOccurrences(trace, "\"name\":\"inner\""), 20);
+  ASSERT_EQ(CountOccurrences(trace, "\"ph\":\"X\""), 40);
+
+  Tracer::Clear();
+  Tracer::WriteChromeTrace(path);
+  ASSERT_EQ(CountOccurrences(ReadTrace(path), "\"ph\":\"X\""), 0);
+  std::remove(path.c_str());
+}
+
+TEST(TracerTests, DropsSpansOnceBufferIsFull) {
+  auto path = testing::TempDir() + "trace_full.json";
+  Tracer::Clear();
+  Tracer::Start(/*events_per_thread=*/3);
+
+  // A new thread, so that its buffer gets the smaller capacity
+  std::thread worker([] {
+    for (int i = 0; i < 5; ++i) {
+      ScopedSpan span("limited");
+    }
+  });
+  worker.join();
+  Tracer::Stop();
+
+  Tracer::WriteChromeTrace(path);
+  auto trace = ReadTrace(path);
+  ASSERT_EQ(CountOccurrences(trace, "\"name\":\"limited\""), 3);
+  ASSERT_NE(trace.find("\"dropped_spans\":\"2\""), std::string::npos);
+  std::remove(path.c_str());
+}
+
+TEST(TracerTests, ReusesBuffersOfExitedThreads) {
+  auto path = testing::TempDir() + "trace_reuse.json";
+  Tracer::Clear();
+  Tracer::Start();
+
+  for (int i = 0; i < 3; ++i) {
+    std::thread worker([] { ScopedSpan span("sequential"); });
+    worker.join();
+  }
+  Tracer::Stop();
+
+  Tracer::WriteChromeTrace(path);
+  auto trace = ReadTrace(path);
+  ASSERT_EQ(CountOccurrences(trace, "\"name\":\"sequential\""), 3);
+  // One after the other, the threads all wrote to the same buffer
+  auto first = trace.find("\"name\":\"sequential\"");
+  auto tid = trace.substr(trace.find("\"tid\"", first),
+                          trace.find(",\"ts\"", first) -
+                              trace.find("\"tid\"", first));
+  ASSERT_EQ(CountOccurrences(trace, "\"ph\":\"X\",\"pid\":1," + tid + ","),
+            3);
+  std::remove(path.c_str());
+}
+
+TEST(TracerTests, StopsAllocatingAtTheMemoryCap) {
+  auto path = testing::TempDir() + "trace_capped.json";
+  Tracer::Clear();
+  Tracer::Start(/*events_per_thread=*/1 << 18, /*max_events=*/0);
+
+  // More spans than one chunk, so at least some need new memory
+  std::thread worker([] {
+    for (int i = 0; i < 5000; ++i) {
+      ScopedSpan span("capped");
+    }
+  });
+  worker.join();
+  Tracer::Stop();
+
+  Tracer::WriteChromeTrace(path);
+  auto trace = ReadTrace(path);
+  ASSERT_LT(CountOccurrences(trace, "\"name\":\"capped\""), 5000);
+  ASSERT_EQ(trace.find("\"dropped_spans\":\"0\""), std::string::npos);
+  std::remove(path.c_str());
+  // Restore the default limits
+  Tracer::Start();
+  Tracer::Stop();
+}
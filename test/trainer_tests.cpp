@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <rollout_evaluator.h>
+#include <trainer.h>
+
+#include <numeric>
+
+#include "mock_evaluator.h"
+
+namespace {
+
+std::vector<Example> MakeTrainerExamples(int num_examples) {
+  std::vector<Example> examples;
+  for (int i = 0; i < num_examples; ++i) {
+    std::vector<int> board = {i % 3 - 1, i % 2, -(i % 2), 0};
+    std::vector<float> action_probs = {0.1, 0.2, 0.3, 0.4};
+    examples.push_back({board, 1, action_probs, static_cast<float>(i % 3 - 1)});
+  }
+  return examples;
+}
+
+TrainerOptions GetTrainerOptions(uint32_t data_parallel_threads) {
+  TrainerOptions options;
+  options.batch_size = 16;
+  options.num_episodes = 0;
+  options.num_epochs = 2;
+  options.num_simulations = 0;
+  options.training_iterations = 0;
+  options.data_parallel_threads = data_parallel_threads;
+  return options;
+}
+
+}  // namespace
+
+TEST(TrainerTests, ValueLossMatchesTargetShape) {
+  auto trainer = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                         GetTrainerOptions(1));
+  auto targets = torch::tensor(std::vector<float>({1, -1, 0}));
+  auto outputs = torch::tensor(std::vector<float>({1, 1, 0.5})).view({3, 1});
+
+  auto losses = trainer.GetValueLosses(targets, outputs);
+
+  ASSERT_EQ(losses.dim(), 1);
+  ASSERT_EQ(losses.size(0), 3);
+  ASSERT_FLOAT_EQ(trainer.GetValueLoss(targets, outputs).item<float>(),
+                  (0 + 4 + 0.25) / 3.0);
+}
+
+TEST(TrainerTests, DataParallelTrainingMatchesOneThread) {
+  auto examples = MakeTrainerExamples(64);
+
+  torch::manual_seed(0);
+  auto serial = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                        GetTrainerOptions(1));
+  torch::manual_seed(0);
+  auto parallel = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                          GetTrainerOptions(3));
+
+  auto serial_losses = serial.Train(examples);
+  auto parallel_losses = parallel.Train(examples);
+
+  ASSERT_EQ(serial_losses.steps, parallel_losses.steps);
+  ASSERT_NEAR(serial_losses.policy, parallel_losses.policy, 1e-5);
+  ASSERT_NEAR(serial_losses.value, parallel_losses.value, 1e-5);
+  auto serial_parameters = serial.GetModel().parameters();
+  auto parallel_parameters = parallel.GetModel().parameters();
+  for (size_t i = 0; i < serial_parameters.size(); ++i) {
+    ASSERT_TRUE(torch::allclose(serial_parameters[i], parallel_parameters[i],
+                                /*rtol=*/1e-4, /*atol=*/1e-5));
+  }
+}
+
+TEST(TrainerTests, HogwildTrainingLowersTheLoss) {
+  auto examples = MakeTrainerExamples(256);
+  auto options = GetTrainerOptions(4);
+  options.num_epochs = 10;
+  options.hogwild = true;
+
+  torch::manual_seed(0);
+  auto trainer =
+      Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU), options);
+  auto first_losses = trainer.Train(examples);
+  auto later_losses = trainer.Train(examples);
+
+  ASSERT_EQ(first_losses.steps, 10u * 256 / 16);
+  ASSERT_LT(later_losses.policy + later_losses.value,
+            first_losses.policy + first_losses.value);
+}
+
+TEST(TrainerTests, ForcedMovesGetOneHotTargets) {
+  // Searches may stop before their first simulation on the last move, which
+  // is forced
+  auto options = GetTrainerOptions(1);
+  options.num_simulations = 2;
+  options.min_simulations = 0;
+  auto trainer = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                         options);
+  auto model = GetMockModel({0.4, 0.1, 0.1, 0.4}, 0);
+
+  auto examples = trainer.ExecuteEpisode(model);
+
+  ASSERT_EQ(examples.size(), 4u);
+  for (const auto& example : examples) {
+    ASSERT_NEAR(std::accumulate(example.action_probs.begin(),
+                                example.action_probs.end(), 0.0f),
+                1, 1e-6);
+  }
+  ASSERT_NEAR(examples.back().action_probs[3], 1, 1e-6);
+}
+
+TEST(TrainerTests, ResignsDecidedGames) {
+  // Connect2 is won by the first player. With this search the second player
+  // sees a root value below -0.9 on its only move.
+  auto options = GetTrainerOptions(1);
+  options.num_simulations = 50;
+  options.resignation.threshold = 0.9;
+  options.resignation.consecutive_moves = 1;
+  options.resignation.playout_fraction = 0;
+  auto trainer = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                         options);
+  RolloutEvaluator evaluator(1, 4, 2);
+
+  auto examples = trainer.ExecuteEpisode(evaluator);
+
+  ASSERT_EQ(examples.size(), 1u);
+  ASSERT_EQ(examples[0].reward, 1);
+  const auto& stats = trainer.GetSelfPlayStats();
+  ASSERT_EQ(stats.games, 1u);
+  ASSERT_EQ(stats.moves, 1u);
+  ASSERT_EQ(stats.resignations, 1u);
+  ASSERT_EQ(stats.resignations_checked, 0u);
+}
+
+TEST(TrainerTests, ZeroConsecutiveMovesResignsLikeOne) {
+  // The winning first player must not resign on its first move
+  auto options = GetTrainerOptions(1);
+  options.num_simulations = 50;
+  options.resignation.threshold = 0.9;
+  options.resignation.consecutive_moves = 0;
+  options.resignation.playout_fraction = 0;
+  auto trainer = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                         options);
+  RolloutEvaluator evaluator(1, 4, 2);
+
+  auto examples = trainer.ExecuteEpisode(evaluator);
+
+  ASSERT_EQ(examples.size(), 1u);
+  ASSERT_EQ(examples[0].reward, 1);
+  ASSERT_EQ(trainer.GetSelfPlayStats().resignations, 1u);
+}
+
+TEST(TrainerTests, PlaysOutGamesToCheckResignations) {
+  auto options = GetTrainerOptions(1);
+  options.num_simulations = 50;
+  options.resignation.threshold = 0.9;
+  options.resignation.consecutive_moves = 1;
+  options.resignation.playout_fraction = 1;
+  auto trainer = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                         options);
+  RolloutEvaluator evaluator(1, 4, 2);
+
+  auto examples = trainer.ExecuteEpisode(evaluator);
+
+  ASSERT_EQ(examples.size(), 3u);
+  const auto& stats = trainer.GetSelfPlayStats();
+  ASSERT_EQ(stats.resignations, 0u);
+  ASSERT_EQ(stats.resignations_checked, 1u);
+  // The second player did go on to lose
+  ASSERT_EQ(stats.false_resignations, 0u);
+  ASSERT_EQ(stats.GetFalseResignationRate(), 0);
+}
+
+TEST(TrainerTests, OverlapsSelfPlayWithTraining) {
+  auto options = GetTrainerOptions(1);
+  options.batch_size = 4;
+  options.num_episodes = 8;
+  options.num_simulations = 10;
+  options.training_iterations = 3;
+  options.publish_interval = 1;
+  options.overlap_self_play = true;
+  auto trainer = Trainer(Connect2Game(), Connect2Model(4, 4, torch::kCPU),
+                         options);
+
+  ASSERT_EQ(trainer.Learn(), 3u);
+  // The initial weights, then every optimizer step of every iteration
+  ASSERT_GT(trainer.GetPublisher().GetVersion(), 1u + 3u);
+}
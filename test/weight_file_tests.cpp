@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <weight_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+TEST(WeightFileTests, RoundTripsThroughFile) {
+  auto path = testing::TempDir() + "weight_file_round_trip.bin";
+  WriteWeightFile(path, {{"fc.weight", {2, 3}, {1, 2, 3, 4, 5, 6}},
+                         {"fc.bias", {2}, {-1, -2}}});
+  WeightFile weights(path);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(weights.GetNumTensors(), 2u);
+  ASSERT_TRUE(weights.Has("fc.bias"));
+  ASSERT_FALSE(weights.Has("fc"));
+  ASSERT_EQ(weights.GetShape("fc.weight"), std::vector<int64_t>({2, 3}));
+
+  auto weight = weights.Get("fc.weight", {2, 3});
+  ASSERT_EQ(std::vector<float>(weight, weight + 6),
+            std::vector<float>({1, 2, 3, 4, 5, 6}));
+  auto bias = weights.Get("fc.bias", {2});
+  ASSERT_EQ(bias[0], -1);
+  ASSERT_EQ(bias[1], -2);
+}
+
+TEST(WeightFileTests, AlignsEveryTensor) {
+  auto path = testing::TempDir() + "weight_file_alignment.bin";
+  WriteWeightFile(path, {{"a", {3}, {1, 2, 3}},
+                         {"b", {1}, {4}},
+                         {"c", {5, 1}, {5, 6, 7, 8, 9}}});
+  WeightFile weights(path);
+  std::remove(path.c_str());
+
+  for (auto name : {"a", "b", "c"}) {
+    auto values = weights.Get(name, weights.GetShape(name));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(values) % kWeightAlignment, 0u);
+  }
+  ASSERT_EQ(weights.Get("c", {5, 1})[4], 9);
+}
+
+TEST(WeightFileTests, RejectsWrongShapeOrName) {
+  auto path = testing::TempDir() + "weight_file_shape.bin";
+  WriteWeightFile(path, {{"fc.weight", {2, 3}, {1, 2, 3, 4, 5, 6}}});
+  WeightFile weights(path);
+  std::remove(path.c_str());
+
+  ASSERT_THROW(weights.Get("fc.weight", {3, 2}), std::runtime_error);
+  ASSERT_THROW(weights.Get("fc.bias", {2}), std::runtime_error);
+  ASSERT_THROW(WriteWeightFile(path, {{"fc.bias", {3}, {1, 2}}}),
+               std::invalid_argument);
+}
+
+TEST(WeightFileTests, RejectsOtherAndTruncatedFiles) {
+  auto path = testing::TempDir() + "weight_file_invalid.bin";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "not a weight file at all";
+  }
+  ASSERT_THROW(WeightFile weights(path), std::runtime_error);
+
+  WriteWeightFile(path, {{"fc.weight", {64}, std::vector<float>(64, 1)}});
+  {
+    // Cut the values short
+    std::ifstream in(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 4);
+  }
+  ASSERT_THROW(WeightFile weights(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(WeightFileTests, RejectsCorruptEntries) {
+  auto path = testing::TempDir() + "weight_file_corrupt.bin";
+  auto patch_entry = [&](size_t field_offset, uint64_t value, size_t size) {
+    WriteWeightFile(path, {{"fc.weight", {2, 3}, {1, 2, 3, 4, 5, 6}}});
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(WeightFileHeader) + field_offset);
+    file.write(reinterpret_cast<const char*>(&value), size);
+  };
+
+  patch_entry(offsetof(WeightFileEntry, rank), 9, sizeof(uint32_t));
+  ASSERT_THROW(WeightFile weights(path), std::runtime_error);
+  patch_entry(offsetof(WeightFileEntry, num_elements), 7, sizeof(uint64_t));
+  ASSERT_THROW(WeightFile weights(path), std::runtime_error);
+  patch_entry(offsetof(WeightFileEntry, shape), -6, sizeof(int64_t));
+  ASSERT_THROW(WeightFile weights(path), std::runtime_error);
+  patch_entry(offsetof(WeightFileEntry, offset), ~uint64_t{0} - 63,
+              sizeof(uint64_t));
+  ASSERT_THROW(WeightFile weights(path), std::runtime_error);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <model.h>
+#include <weight_publisher.h>
+
+namespace {
+
+void FillParameters(torch::nn::Module& model, float value) {
+  torch::NoGradGuard guard;
+  for (auto& parameter : model.parameters()) {
+    parameter.fill_(value);
+  }
+}
+
+bool HaveEqualParameters(const torch::nn::Module& a,
+                         const torch::nn::Module& b) {
+  auto a_parameters = a.parameters();
+  auto b_parameters = b.parameters();
+  for (size_t i = 0; i < a_parameters.size(); ++i) {
+    if (!torch::equal(a_parameters[i], b_parameters[i])) {
+      return false;
+    }
+  }
+  return a_parameters.size() == b_parameters.size();
+}
+
+}  // namespace
+
+TEST(WeightPublisherTests, VersionsCountPublishes) {
+  auto model = Connect2Model(4, 4, torch::kCPU);
+  WeightPublisher publisher;
+
+  ASSERT_EQ(publisher.GetVersion(), 0u);
+  ASSERT_EQ(publisher.GetLatest(), nullptr);
+  ASSERT_EQ(publisher.Publish(model), 1u);
+  ASSERT_EQ(publisher.Publish(model), 2u);
+  ASSERT_EQ(publisher.GetLatest()->version, 2u);
+}
+
+TEST(WeightPublisherTests, SnapshotIsUnaffectedByLaterTraining) {
+  auto model = Connect2Model(4, 4, torch::kCPU);
+  WeightPublisher publisher;
+  FillParameters(model, 1);
+  publisher.Publish(model);
+
+  FillParameters(model, 2);
+
+  for (const auto& tensor : publisher.GetLatest()->tensors) {
+    ASSERT_TRUE(torch::equal(tensor.second, torch::ones_like(tensor.second)));
+  }
+}
+
+TEST(WeightPublisherTests, SubscriberLoadsTheLatestWeights) {
+  auto model = Connect2Model(4, 4, torch::kCPU);
+  auto replica = Connect2Model(4, 4, torch::kCPU);
+  WeightPublisher publisher;
+  WeightSubscriber subscriber(publisher, replica);
+
+  ASSERT_FALSE(subscriber.Refresh());
+  ASSERT_EQ(subscriber.GetVersion(), 0u);
+
+  publisher.Publish(model);
+  ASSERT_TRUE(subscriber.Refresh());
+  ASSERT_EQ(subscriber.GetVersion(), 1u);
+  ASSERT_TRUE(HaveEqualParameters(model, replica));
+  ASSERT_FALSE(subscriber.Refresh());
+
+  FillParameters(model, 3);
+  publisher.Publish(model);
+  ASSERT_TRUE(subscriber.Refresh());
+  ASSERT_EQ(subscriber.GetVersion(), 2u);
+  ASSERT_TRUE(HaveEqualParameters(model, replica));
+}
+
+TEST(WeightPublisherTests, SubscriberRejectsADifferentModel) {
+  auto model = Connect2Model(4, 4, torch::kCPU);
+  auto other = Connect2Model(4, 3, torch::kCPU);
+  WeightPublisher publisher;
+  WeightSubscriber subscriber(publisher, other);
+
+  publisher.Publish(model);
+
+  ASSERT_THROW(subscriber.Refresh(), std::runtime_error);
+}
@@ -0,0 +1,77 @@
+// Writes an opening book that MCTSOptions::opening_book can use, either from
+// a deep search of every position within max_depth moves of the start or from
+// the visit counts of recorded self-play games.
+//
+// Usage: buildOpeningBook <output_file> <max_depth> [--game connect2|connect4]
+//                         [--simulations N] [--weights weight_file]
+//                         [--records game_records]
+//
+// Searches use the MappedConnect2Model in --weights, or random rollouts
+// without one. With --records the games are aggregated instead of searching.
+
+#include <game.h>
+#include <mapped_model.h>
+#include <opening_book.h>
+#include <rollout_evaluator.h>
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+int main(int argc, char** argv) {
+  if (argc < 3 || argc % 2 == 0) {
+    std::cerr << "Usage: " << argv[0]
+              << " <output_file> <max_depth> [--game connect2|connect4]"
+              << " [--simulations N] [--weights weight_file]"
+              << " [--records game_records]" << std::endl;
+    return 1;
+  }
+  std::string path = argv[1];
+  int max_depth = std::stoi(argv[2]);
+  std::map<std::string, std::string> args;
+  for (int i = 3; i + 1 < argc; i += 2) {
+    args[argv[i]] = argv[i + 1];
+  }
+  auto get = [&args](const std::string& name, const std::string& fallback) {
+    auto it = args.find(name);
+    return it == args.end() ? fallback : it->second;
+  };
+
+  std::unique_ptr<ConnectXGame> game;
+  std::unique_ptr<Evaluator> rollouts;
+  if (get("--game", "connect2") == "connect4") {
+    game = std::make_unique<Connect4Game>();
+    rollouts = std::make_unique<RolloutEvaluator>(
+        FixedConnect4Game::kRows, FixedConnect4Game::kColumns,
+        FixedConnect4Game::kNumToWin);
+  } else {
+    game = std::make_unique<Connect2Game>();
+    rollouts = std::make_unique<RolloutEvaluator>(
+        FixedConnect2Game::kRows, FixedConnect2Game::kColumns,
+        FixedConnect2Game::kNumToWin);
+  }
+  int board_size = game->GetInitBoard().size();
+  int action_size = game->GetValidMoves(game->GetInitBoard()).size();
+
+  BookPositions positions;
+  if (args.count("--records")) {
+    AddRecordedGames(*game, args["--records"], max_depth, positions);
+  } else {
+    std::unique_ptr<Evaluator> weights;
+    if (args.count("--weights")) {
+      weights = std::make_unique<MappedConnect2Model>(args["--weights"],
+                                                      board_size, action_size);
+    }
+    MCTSOptions options;
+    options.use_solver = true;
+    options.lazy_children = true;
+    AddSearchedPositions(*game, weights ? *weights : *rollouts, max_depth,
+                         std::stoi(get("--simulations", "10000")), options,
+                         positions);
+  }
+
+  WriteOpeningBook(path, board_size, action_size, positions);
+  std::cout << "Wrote " << positions.size() << " positions to " << path
+            << std::endl;
+}
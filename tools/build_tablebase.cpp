@@ -0,0 +1,45 @@
+// Solves every position of a ConnectX game with at most max_empty_cells empty
+// cells and writes them to a tablebase file that MCTSOptions::tablebase can
+// use.
+//
+// Usage: buildTablebase <output_file> <rows> <columns> <num_to_win>
+//                       <max_empty_cells>
+
+#include <game.h>
+#include <tablebase.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char** argv) {
+  if (argc != 6) {
+    std::cerr << "Usage: " << argv[0]
+              << " <output_file> <rows> <columns> <num_to_win>"
+              << " <max_empty_cells>" << std::endl;
+    return 1;
+  }
+  std::string path = argv[1];
+  int max_empty_cells = std::stoi(argv[5]);
+
+  std::unique_ptr<ConnectXGame> game;
+  try {
+    game = MakeConnectXGame(std::stoi(argv[2]), std::stoi(argv[3]),
+                            std::stoi(argv[4]));
+  } catch (const std::invalid_argument& error) {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  auto endgames = SolveEndgames(*game, max_empty_cells);
+  auto init_board = game->GetInitBoard();
+  WriteTablebase(path, init_board.size(),
+                 game->GetValidMoves(init_board).size(), endgames);
+
+  int counts[3] = {0, 0, 0};
+  for (auto& entry : endgames) {
+    ++counts[entry.second + 1];
+  }
+  std::cout << "Wrote " << endgames.size() << " positions to " << path
+            << " (wins: " << counts[2] << ", draws: " << counts[1]
+            << ", losses: " << counts[0] << ")" << std::endl;
+}
@@ -0,0 +1,45 @@
+// Converts a Connect2Model checkpoint into a weight file that
+// MappedConnect2Model can memory-map.
+//
+// Usage: exportWeights <checkpoint> <output_file> [connect2|connect4]
+
+#include <game.h>
+#include <mapped_model.h>
+#include <model.h>
+#include <weight_export.h>
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " <checkpoint> <output_file> [connect2|connect4]"
+              << std::endl;
+    return 1;
+  }
+  std::string checkpoint = argv[1];
+  std::string path = argv[2];
+  std::string game_name = argc == 4 ? argv[3] : "connect2";
+
+  int board_size, action_size;
+  if (game_name == "connect4") {
+    Connect4Game game;
+    board_size = game.GetBoardSize();
+    action_size = game.GetActionSize();
+  } else {
+    Connect2Game game;
+    board_size = game.GetBoardSize();
+    action_size = game.GetActionSize();
+  }
+
+  Connect2Model model(board_size, action_size, torch::kCPU);
+  torch::serialize::InputArchive archive;
+  archive.load_from(checkpoint);
+  model.load(archive);
+
+  ExportWeights(model, path);
+  MappedConnect2Model mapped(path, board_size, action_size);
+  std::cout << "Wrote " << mapped.GetHiddenSize() << " hidden units of "
+            << checkpoint << " to " << path << std::endl;
+}